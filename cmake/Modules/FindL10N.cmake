@@ -75,10 +75,11 @@ function(GETTEXT_FMT domain)
 
   foreach(lang ${parsed_LANGUAGES})
     set(poFile "${CMAKE_CURRENT_SOURCE_DIR}/${lang}.po")
-    set(gmoFile "${CMAKE_CURRENT_BINARY_DIR}/${lang}.gmo")
+    set(gmoFile "${CMAKE_CURRENT_BINARY_DIR}/${lang}/LC_MESSAGES/${domain}.mo")
 
     add_custom_command(
       OUTPUT "${gmoFile}"
+      COMMAND ${CMAKE_COMMAND} -E make_directory "${CMAKE_CURRENT_BINARY_DIR}/${lang}/LC_MESSAGES"
       COMMAND ${GETTEXT_MSGFMT_EXECUTABLE} -o ${gmoFile} ${poFile}
       DEPENDS ${lang}
     )
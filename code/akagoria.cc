@@ -17,21 +17,33 @@
  * You should have received a copy of the GNU General Public License
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <future>
+#include <vector>
 
 #include <boost/locale.hpp>
 
 #include <tmx/Map.h>
 
 #include "game/Action.h"
+#include "game/ActionScript.h"
 #include "game/Camera.h"
 #include "game/Clock.h"
 #include "game/EntityManager.h"
 #include "game/Log.h"
 #include "game/ModelManager.h"
+#include "game/Profiler.h"
+#include "game/RenderQueue.h"
+#include "game/RenderThread.h"
 #include "game/ResourceManager.h"
+#include "game/TextureAtlas.h"
 #include "game/WindowSettings.h"
 
 #include "akgr/Character.h"
@@ -41,6 +53,8 @@
 #include "akgr/GameEvents.h"
 #include "akgr/Hero.h"
 #include "akgr/HeroAttributes.h"
+#include "akgr/MapCache.h"
+#include "akgr/MapLoader.h"
 #include "akgr/MessageManager.h"
 #include "akgr/PhysicsModel.h"
 #include "akgr/RequirementManager.h"
@@ -57,6 +71,225 @@
 
 static constexpr unsigned INITIAL_WIDTH = 1280;
 static constexpr unsigned INITIAL_HEIGHT = 720;
+static constexpr unsigned PROGRESS_PERIOD = 50; /* ms */
+static constexpr unsigned STREAMING_RADIUS = 2; /* cells */
+static constexpr float UPLOAD_BUDGET = 0.004f; /* s */
+static constexpr unsigned PHYSICS_TICK_RATE = 60; /* Hz */
+static constexpr unsigned PHYSICS_MAX_STEPS = 5; /* per frame */
+static constexpr unsigned ATLAS_MAX_SIZE = 4096;
+
+static void addMapImages(const akgr::MapCache& cache, game::TextureAtlas& atlas) {
+  for (auto layer = cache.getLayersBegin(); layer != cache.getLayersEnd(); ++layer) {
+    switch (layer->type) {
+      case akgr::MapCache::LayerType::TILE:
+        if (layer->count > 0) {
+          auto path = cache.getPath(layer->texture);
+          atlas.addImageFromFile(path, path);
+        }
+        break;
+
+      case akgr::MapCache::LayerType::SPRITE: {
+        const akgr::MapCache::SpriteRecord *records = cache.getSprites(*layer);
+
+        for (uint32_t i = 0; i < layer->count; ++i) {
+          auto path = cache.getPath(records[i].texture);
+          atlas.addImageFromFile(path, path);
+        }
+        break;
+      }
+
+      default:
+        break;
+    }
+  }
+}
+
+static void uploadAtlas(game::TextureAtlas& atlas, std::vector<game::ResourceHandle<sf::Texture>>& handles) {
+  atlas.upload(true);
+
+  // the images too big for the atlas are loaded in the background, before the map needs them
+  for (auto& key : atlas.getUnpackedImages()) {
+    handles.push_back(akgr::gResourceManager().requestTexture(key));
+  }
+}
+
+static void dumpTrace(const char *tracePath) {
+  if (tracePath != nullptr) {
+    game::Profiler::dumpToFile(tracePath);
+  }
+}
+
+static void loadMapCache(akgr::MapCache& cache, const boost::filesystem::path& path, std::atomic<float>& progress) {
+  game::ProfileScope scope("map cache");
+
+  // the cache installed next to the map, or the cache of the build tree
+  auto cachePath = path;
+  cachePath.replace_extension(".akmap");
+  boost::filesystem::path buildCachePath(GAME_MAP_CACHE);
+
+  auto isLoaded = [&cache, &path](const boost::filesystem::path& candidate) {
+    return akgr::MapCache::isUpToDate(candidate, path) && cache.loadFromFile(candidate);
+  };
+
+  if (!isLoaded(cachePath) && !isLoaded(buildCachePath)) {
+    game::Log::info(game::Log::RESOURCES, "No valid map cache, parsing the map: '%s'\n", path.string().c_str());
+    auto map = tmx::Map::parseFile(path);
+    cache.loadFromMap(*map, path.parent_path(), [&progress](unsigned done, unsigned total) {
+      progress = 0.5f * done / total;
+    });
+  }
+}
+
+// the sinks that are needed by the game, with or without a window
+static void addGameSinks(akgr::MapLoader& loader) {
+  loader.addSink("zone", akgr::gPhysicsModel(), "physics");
+  loader.addSink("low_sprite", akgr::gPhysicsModel(), "physics");
+  loader.addSink("high_sprite", akgr::gPhysicsModel(), "physics");
+  loader.addSink("low_sprite", akgr::gShrineManager(), "shrines");
+  loader.addSink("high_sprite", akgr::gShrineManager(), "shrines");
+  loader.addSink("poi", akgr::gDataManager(), "points of interest");
+}
+
+// the hero must exist
+static void startGame(akgr::Story& story, akgr::MapLoader& loader, int slotToLoad) {
+  if (slotToLoad != -1) {
+    akgr::gSavePointManager().loadFromSlot(slotToLoad);
+  } else {
+    story.start();
+  }
+
+  loader.loadCellsAround(akgr::gHero().getPosition());
+  akgr::gEventManager().registerHandler<akgr::HeroLocationEvent>([&loader](game::EventType type, game::Event *event) {
+    auto heroLocation = static_cast<akgr::HeroLocationEvent*>(event);
+    loader.requestCellsAround(heroLocation->loc.pos);
+    return game::EventStatus::KEEP;
+  });
+
+  akgr::gHero().broadcastLocation();
+  akgr::gCharacterManager().updateCharacterSearch();
+
+  akgr::gMainEntityManager().addEntity(akgr::gCharacterManager());
+  akgr::gMainEntityManager().addEntity(akgr::gShrineManager());
+}
+
+static void driveGame(akgr::GameDriver& gameDriver, game::Action& leftAction, game::Action& rightAction, game::Action& upAction, game::Action& downAction, game::Action& useAction) {
+  if (leftAction.isActive()) {
+    gameDriver.onHorizontalAction(akgr::HorizontalAction::LEFT);
+  } else if (rightAction.isActive()) {
+    gameDriver.onHorizontalAction(akgr::HorizontalAction::RIGHT);
+  } else {
+    gameDriver.onHorizontalAction(akgr::HorizontalAction::NONE);
+  }
+
+  if (upAction.isActive()) {
+    gameDriver.onVerticalAction(akgr::VerticalAction::UP);
+  } else if (downAction.isActive()) {
+    gameDriver.onVerticalAction(akgr::VerticalAction::DOWN);
+  } else {
+    gameDriver.onVerticalAction(akgr::VerticalAction::NONE);
+  }
+
+  if (useAction.isActive()) {
+    gameDriver.onUse();
+  }
+}
+
+/*
+ * The game without any window nor graphics context: the map is loaded
+ * without the graphical sinks, the actions come from a script and the
+ * simulation runs as fast as possible with a fixed time step. The run
+ * stops at the end of the script.
+ */
+static int runHeadless(const char *scriptPath, const char *tracePath) {
+  game::Action closeWindowAction("Close window");
+  game::Action leftAction("Left");
+  leftAction.setContinuous();
+  game::Action rightAction("Right");
+  rightAction.setContinuous();
+  game::Action upAction("Up");
+  upAction.setContinuous();
+  game::Action downAction("Down");
+  downAction.setContinuous();
+  game::Action useAction("Use");
+  game::Action traceAction("Trace");
+
+  game::ActionManager actions;
+  game::ActionScript script;
+
+  for (auto action : { &closeWindowAction, &leftAction, &rightAction, &upAction, &downAction, &useAction, &traceAction }) {
+    actions.addAction(*action);
+    script.addAction(*action);
+  }
+
+  if (!script.loadFromFile(scriptPath)) {
+    return EXIT_FAILURE;
+  }
+
+  // map
+  akgr::MapCache cache;
+  std::atomic<float> cacheProgress(0.0f);
+  loadMapCache(cache, akgr::gResourceManager().getAbsolutePath("maps/map.tmx"), cacheProgress);
+
+  game::ModelManager models;
+  models.setFixedTimestep(1.0f / PHYSICS_TICK_RATE, PHYSICS_MAX_STEPS);
+  models.addModel(akgr::gPhysicsModel());
+  akgr::gPhysicsModel().setActivityRadius(STREAMING_RADIUS);
+
+  akgr::MapLoader loader;
+  loader.setStreamingRadius(STREAMING_RADIUS);
+  addGameSinks(loader);
+  loader.load(cache);
+
+  // game
+  akgr::Story story;
+
+  auto startLocation = akgr::gDataManager().getPointOfInterestDataFor("Start"_id);
+  assert(startLocation);
+
+  game::SingletonStorage<akgr::Hero> storageForHero(akgr::gHero, startLocation->loc);
+  akgr::gMainEntityManager().addEntity(akgr::gHero());
+
+  startGame(story, loader, -1);
+
+  akgr::gHeadsUpEntityManager().addEntity(akgr::gDialogManager());
+  akgr::gHeadsUpEntityManager().addEntity(akgr::gMessageManager());
+  akgr::gHeadsUpEntityManager().addEntity(akgr::gHeroAttributes());
+
+  akgr::GameDriver gameDriver(upAction, downAction);
+
+  // main loop, with the same time for each frame
+  const float dt = 1.0f / PHYSICS_TICK_RATE;
+  game::Clock clock;
+
+  while (!script.isFinished()) {
+    script.update();
+
+    if (closeWindowAction.isActive()) {
+      break;
+    }
+
+    driveGame(gameDriver, leftAction, rightAction, upAction, downAction, useAction);
+
+    if (traceAction.isActive()) {
+      dumpTrace(tracePath);
+    }
+
+    models.update(dt);
+
+    gameDriver.update(dt);
+    akgr::gMainEntityManager().update(dt);
+    akgr::gHeadsUpEntityManager().update(dt);
+
+    actions.reset();
+  }
+
+  auto elapsed = clock.getElapsedTime().asSeconds();
+  unsigned frames = script.getFrame();
+  game::Log::info(game::Log::GENERAL, "Headless run: %u frames in %.3f s (%.3f ms per frame)\n", frames, elapsed, frames > 0 ? 1000.0f * elapsed / frames : 0.0f);
+
+  dumpTrace(tracePath);
+  return EXIT_SUCCESS;
+}
 
 enum class StartMode {
   MAIN,
@@ -73,10 +306,27 @@ int main(int argc, char *argv[]) {
 
   game::Log::info(game::Log::GENERAL, "Locale is: %s\n", std::locale("").name().c_str());
 
+  // the trace is written on exit and on the "Trace" action
+  const char *tracePath = std::getenv("AKAGORIA_TRACE");
+  game::Profiler::setEnabled(tracePath != nullptr);
+
+  // --headless <script>: no window, the actions come from the script
+  const char *scriptPath = nullptr;
+
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--headless") == 0 && i + 1 < argc) {
+      scriptPath = argv[++i];
+    } else {
+      game::Log::error(game::Log::GENERAL, "Usage: %s [--headless <script>]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
   // singletons
   game::SingletonStorage<game::Random> storageForRandom(akgr::gRandom);
   game::SingletonStorage<game::ResourceManager> storageForResourceManager(akgr::gResourceManager);
   akgr::gResourceManager().addSearchDir(GAME_DATADIR);
+  game::SingletonStorage<game::TextureAtlas> storageForTextureAtlas(akgr::gTextureAtlas);
 
   game::SingletonStorage<game::EventManager> storageForEventManager(akgr::gEventManager);
   game::SingletonStorage<game::EntityManager> storageForMainEntityManager(akgr::gMainEntityManager);
@@ -97,7 +347,11 @@ int main(int argc, char *argv[]) {
   game::SingletonStorage<game::WindowGeometry> storageForWindowGeometry(akgr::gWindowGeometry, INITIAL_WIDTH, INITIAL_HEIGHT);
 
   // load data
-  akgr::gDataManager().load(GAME_DATADIR);
+  akgr::gDataManager().load(GAME_DATADIR, GAME_LOCALEDIR, GAME_DATABASE);
+
+  if (scriptPath != nullptr) {
+    return runHeadless(scriptPath, tracePath);
+  }
 
   // initialize window
   game::WindowSettings settings(INITIAL_WIDTH, INITIAL_HEIGHT, "Akagoria (version " GAME_VERSION ")");
@@ -106,11 +360,18 @@ int main(int argc, char *argv[]) {
   settings.applyTo(window);
   window.setKeyRepeatEnabled(false);
 
+  // the draw commands of the frame
+  game::RenderQueue worldQueue;
+  game::RenderQueue headsUpQueue;
+
   // splash screen
   akgr::SplashUI splashUI;
 
+  headsUpQueue.setView(window.getDefaultView());
+  splashUI.displaySplashMessage(headsUpQueue, true);
+
   window.clear(sf::Color::Black);
-  splashUI.displaySplashMessage(window, true);
+  headsUpQueue.flush(window);
   window.display();
 
   // add cameras
@@ -118,11 +379,6 @@ int main(int argc, char *argv[]) {
 
   game::FlexibleCamera mainCamera(INITIAL_WIDTH);
   cameras.addCamera(mainCamera);
-  akgr::gEventManager().registerHandler<akgr::HeroLocationEvent>([&mainCamera](game::EventType type, game::Event *event) {
-    auto heroLocation = static_cast<akgr::HeroLocationEvent*>(event);
-    mainCamera.setCenter(heroLocation->loc.pos);
-    return game::EventStatus::KEEP;
-  });
 
   game::HeadsUpCamera headsUpCamera(window);
   cameras.addCamera(headsUpCamera);
@@ -162,6 +418,35 @@ int main(int argc, char *argv[]) {
   useAction.addKeyControl(sf::Keyboard::X);
   actions.addAction(useAction);
 
+  game::Action traceAction("Trace");
+  traceAction.addKeyControl(sf::Keyboard::F12);
+  actions.addAction(traceAction);
+
+
+  // start loading the map while the player is in the start screen
+  auto path = akgr::gResourceManager().getAbsolutePath("maps/map.tmx");
+
+  akgr::MapCache cache;
+  bool cacheReady = false;
+
+  // the first half of the progress is for the cache, the second half for the sinks
+  std::atomic<float> cacheProgress(0.0f);
+
+  // the map images and the hero are packed in an atlas, the textures are created on this thread
+  unsigned atlasSize = std::min(sf::Texture::getMaximumSize(), ATLAS_MAX_SIZE);
+  auto heroPath = akgr::gResourceManager().getAbsolutePath(akgr::Hero::HERO_TEXTURE);
+
+  auto cacheLoading = std::async(std::launch::async, [&cache, &path, &cacheProgress, atlasSize, heroPath]() {
+    loadMapCache(cache, path, cacheProgress);
+
+    addMapImages(cache, akgr::gTextureAtlas());
+    akgr::gTextureAtlas().addImageFromFile(akgr::Hero::HERO_TEXTURE, heroPath);
+    akgr::gTextureAtlas().build(atlasSize);
+  });
+
+  // the resources are requested in the background during the start screen
+  auto fontHandle = akgr::gResourceManager().requestFont("fonts/DejaVuSansMono-Bold.ttf");
+  std::vector<game::ResourceHandle<sf::Texture>> textureHandles;
 
   // UI for start screen
   akgr::StartDriver startDriver;
@@ -182,6 +467,7 @@ int main(int argc, char *argv[]) {
 
     if (closeWindowAction.isActive()) {
       window.close();
+      dumpTrace(tracePath);
       return EXIT_SUCCESS;
     }
 
@@ -216,6 +502,7 @@ int main(int argc, char *argv[]) {
 
       if (result == akgr::StartChoice::QUIT) {
         window.close();
+        dumpTrace(tracePath);
         return EXIT_FAILURE;
       }
     }
@@ -224,25 +511,38 @@ int main(int argc, char *argv[]) {
     auto dt = clock.restart().asSeconds();
     startDriver.update(dt);
 
-    // render
-    window.clear(sf::Color::Black);
+    if (!cacheReady && cacheLoading.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+      cacheLoading.get();
+      uploadAtlas(akgr::gTextureAtlas(), textureHandles);
+      cacheReady = true;
+    }
 
-    headsUpCamera.configure(window);
-    splashUI.render(window);
-    startDriver.render(window);
+    akgr::gResourceManager().update(UPLOAD_BUDGET);
 
+    // render
+    headsUpCamera.configure(headsUpQueue);
+    splashUI.render(headsUpQueue);
+    startDriver.render(headsUpQueue);
+
+    window.clear(sf::Color::Black);
+    headsUpQueue.flush(window);
     window.display();
 
     actions.reset();
   }
 
+  headsUpCamera.configure(headsUpQueue);
+  splashUI.displaySplashMessage(headsUpQueue, true);
+
   window.clear(sf::Color::Black);
-  splashUI.displaySplashMessage(window, true);
+  headsUpQueue.flush(window);
   window.display();
 
   // add entities
   game::ModelManager models;
+  models.setFixedTimestep(1.0f / PHYSICS_TICK_RATE, PHYSICS_MAX_STEPS);
   models.addModel(akgr::gPhysicsModel());
+  akgr::gPhysicsModel().setActivityRadius(STREAMING_RADIUS);
 
   akgr::TileMap groundMap(-30);
   akgr::gMainEntityManager().addEntity(groundMap);
@@ -259,19 +559,45 @@ int main(int argc, char *argv[]) {
   akgr::SpriteMap hiSpriteMap(20);
   akgr::gMainEntityManager().addEntity(hiSpriteMap);
 
+  akgr::MapLoader loader;
+  loader.setStreamingRadius(STREAMING_RADIUS);
+
   {
-    auto path = akgr::gResourceManager().getAbsolutePath("maps/map.tmx");
-    auto map = tmx::Map::parseFile(path);
+    auto displayProgress = [&window, &splashUI, &headsUpQueue](float progress) {
+      sf::Event event;
+
+      while (window.pollEvent(event)) {
+        akgr::gWindowGeometry().update(event);
+      }
+
+      splashUI.setProgress(progress);
+      splashUI.displaySplashMessage(headsUpQueue, true);
 
-    groundMap.loadMap(*map, "ground");
-    loTileMap.loadMap(*map, "low_tile");
-    hiTileMap.loadMap(*map, "high_tile");
+      window.clear(sf::Color::Black);
+      headsUpQueue.flush(window);
+      window.display();
+    };
 
-    loSpriteMap.loadMap(*map, "low_sprite");
-    hiSpriteMap.loadMap(*map, "high_sprite");
+    if (!cacheReady) {
+      while (cacheLoading.wait_for(std::chrono::milliseconds(PROGRESS_PERIOD)) != std::future_status::ready) {
+        displayProgress(cacheProgress);
+      }
+
+      cacheLoading.get();
+      uploadAtlas(akgr::gTextureAtlas(), textureHandles);
+    }
 
-    akgr::gPhysicsModel().loadMap(*map);
-    akgr::gDataManager().loadMap(*map);
+    loader.addSink("ground", groundMap, "ground tiles");
+    loader.addSink("low_tile", loTileMap, "low tiles");
+    loader.addSink("high_tile", hiTileMap, "high tiles");
+    loader.addSink("low_sprite", loSpriteMap, "low sprites");
+    loader.addSink("high_sprite", hiSpriteMap, "high sprites");
+    addGameSinks(loader);
+    loader.load(cache, [&displayProgress](unsigned done, unsigned total) {
+      displayProgress(0.5f + 0.5f * done / total);
+    });
+
+    splashUI.setProgress(-1.0f);
   }
 
   upAction.setContinuous();
@@ -280,25 +606,14 @@ int main(int argc, char *argv[]) {
   akgr::Story story;
 
   // hero
-  auto startLocation = akgr::gDataManager().getPointOfInterestDataFor("Start");
+  auto startLocation = akgr::gDataManager().getPointOfInterestDataFor("Start"_id);
   assert(startLocation);
 
   game::SingletonStorage<akgr::Hero> storageForHero(akgr::gHero, startLocation->loc);
+  akgr::gHero().loadAnimations();
   akgr::gMainEntityManager().addEntity(akgr::gHero());
 
-  int slotToLoad = startDriver.getSlotToLoad();
-
-  if (slotToLoad != -1) {
-    akgr::gSavePointManager().loadFromSlot(slotToLoad);
-  } else {
-    story.start();
-  }
-
-  akgr::gHero().broadcastLocation();
-  akgr::gCharacterManager().updateCharacterSearch();
-
-  akgr::gMainEntityManager().addEntity(akgr::gCharacterManager());
-  akgr::gMainEntityManager().addEntity(akgr::gShrineManager());
+  startGame(story, loader, startDriver.getSlotToLoad());
 
   akgr::gHeadsUpEntityManager().addEntity(akgr::gDialogManager());
   akgr::gHeadsUpEntityManager().addEntity(akgr::gMessageManager());
@@ -307,6 +622,14 @@ int main(int argc, char *argv[]) {
 
   akgr::GameDriver gameDriver(upAction, downAction);
 
+  // the frames are drawn on a render thread, while the next frame is updated,
+  // the resources and the cells are still uploaded on this thread
+  game::RenderThread renderThread(window);
+  renderThread.setClearColor(sf::Color::White);
+  renderThread.addQueue(worldQueue);
+  renderThread.addQueue(headsUpQueue);
+  renderThread.start();
+
   // main loop
   clock.restart();
 
@@ -322,10 +645,14 @@ int main(int argc, char *argv[]) {
     }
 
     if (closeWindowAction.isActive()) {
+      renderThread.stop();
       window.close();
+      break;
     }
 
     if (fullscreenAction.isActive()) {
+      // the window is recreated on this thread
+      renderThread.stop();
       settings.toggleFullscreen();
       settings.applyTo(window);
       auto sz = window.getSize();
@@ -337,50 +664,41 @@ int main(int argc, char *argv[]) {
       event.size.height = sz.y;
       cameras.update(event);
       akgr::gWindowGeometry().update(event);
-    }
 
-    if (leftAction.isActive()) {
-      gameDriver.onHorizontalAction(akgr::HorizontalAction::LEFT);
-    } else if (rightAction.isActive()) {
-      gameDriver.onHorizontalAction(akgr::HorizontalAction::RIGHT);
-    } else {
-      gameDriver.onHorizontalAction(akgr::HorizontalAction::NONE);
+      renderThread.start();
     }
 
-    if (upAction.isActive()) {
-      gameDriver.onVerticalAction(akgr::VerticalAction::UP);
-    } else if (downAction.isActive()) {
-      gameDriver.onVerticalAction(akgr::VerticalAction::DOWN);
-    } else {
-      gameDriver.onVerticalAction(akgr::VerticalAction::NONE);
-    }
+    driveGame(gameDriver, leftAction, rightAction, upAction, downAction, useAction);
 
-    if (useAction.isActive()) {
-      gameDriver.onUse();
+    if (traceAction.isActive()) {
+      dumpTrace(tracePath);
     }
 
     // update
     auto dt = clock.restart().asSeconds();
 
     models.update(dt);
+    akgr::gResourceManager().update(UPLOAD_BUDGET);
 
     gameDriver.update(dt);
     akgr::gMainEntityManager().update(dt);
     akgr::gHeadsUpEntityManager().update(dt);
 
     // render
-    window.clear(sf::Color::White);
+    mainCamera.setCenter(akgr::gHero().getInterpolatedPosition());
+    mainCamera.configure(worldQueue);
+    akgr::gMainEntityManager().render(worldQueue);
 
-    mainCamera.configure(window);
-    akgr::gMainEntityManager().render(window);
+    headsUpCamera.configure(headsUpQueue);
+    akgr::gHeadsUpEntityManager().render(headsUpQueue);
+    gameDriver.render(headsUpQueue);
 
-    headsUpCamera.configure(window);
-    akgr::gHeadsUpEntityManager().render(window);
-    gameDriver.render(window);
-    window.display();
+    renderThread.submit();
 
     actions.reset();
   }
 
+  renderThread.stop();
+  dumpTrace(tracePath);
   return 0;
 }
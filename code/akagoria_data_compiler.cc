@@ -0,0 +1,62 @@
+/*
+ * Akagoria, the revenge of Kalista
+ * a single-player RPG in an open world with a top-down view.
+ *
+ * Copyright (c) 2013-2015, Julien Bernard
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdio>
+#include <cstdlib>
+
+#include <boost/filesystem.hpp>
+#include <boost/locale.hpp>
+
+#include "game/Log.h"
+
+#include "akgr/DataBase.h"
+#include "akgr/DataParser.h"
+
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+    std::fprintf(stderr, "Usage: %s <datadir> <akagoria.akdb> [<localedir> <language>...]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  game::Log::setLevel(game::Log::INFO);
+
+  boost::filesystem::path datadir = argv[1];
+  boost::filesystem::path databasePath = argv[2];
+
+  akgr::DataBaseWriter writer;
+  akgr::parseDataFiles(datadir, writer);
+
+  if (argc > 3) {
+    boost::locale::generator localeGenerator;
+    localeGenerator.add_messages_path(argv[3]);
+    localeGenerator.add_messages_domain("akagoria");
+
+    for (int i = 4; i < argc; ++i) {
+      std::string language = argv[i];
+      writer.addLanguage(language, localeGenerator(language + ".UTF-8"));
+    }
+  }
+
+  if (!writer.saveToFile(databasePath)) {
+    return EXIT_FAILURE;
+  }
+
+  std::printf("Data base compiled: '%s'\n", databasePath.string().c_str());
+  return EXIT_SUCCESS;
+}
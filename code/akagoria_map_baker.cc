@@ -0,0 +1,58 @@
+/*
+ * Akagoria, the revenge of Kalista
+ * a single-player RPG in an open world with a top-down view.
+ *
+ * Copyright (c) 2013-2015, Julien Bernard
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdio>
+#include <cstdlib>
+
+#include <boost/filesystem.hpp>
+
+#include <tmx/Map.h>
+
+#include "game/Log.h"
+
+#include "akgr/MapCache.h"
+
+int main(int argc, char *argv[]) {
+  if (argc != 3) {
+    std::fprintf(stderr, "Usage: %s <map.tmx> <map.akmap>\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  game::Log::setLevel(game::Log::INFO);
+
+  boost::filesystem::path mapPath = boost::filesystem::absolute(argv[1]);
+  boost::filesystem::path cachePath = argv[2];
+
+  auto map = tmx::Map::parseFile(mapPath);
+
+  if (!map) {
+    std::fprintf(stderr, "Could not parse the map: '%s'\n", mapPath.string().c_str());
+    return EXIT_FAILURE;
+  }
+
+  akgr::MapCache cache;
+  cache.loadFromMap(*map, mapPath.parent_path());
+
+  if (!cache.saveToFile(cachePath)) {
+    return EXIT_FAILURE;
+  }
+
+  std::printf("Map baked: '%s'\n", cachePath.string().c_str());
+  return EXIT_SUCCESS;
+}
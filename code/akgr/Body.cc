@@ -24,6 +24,7 @@
 #include <game/Log.h>
 
 #include "PhysicsModel.h"
+#include "Singletons.h"
 
 namespace akgr {
   Body::Body()
@@ -59,6 +60,23 @@ namespace akgr {
     return m_body->GetAngle();
   }
 
+  sf::Vector2f Body::getVelocity() const {
+    assert(m_body);
+    auto vel = m_body->GetLinearVelocity();
+    return { vel.x / PhysicsModel::BOX2D_SCALE, vel.y / PhysicsModel::BOX2D_SCALE };
+  }
+
+  sf::Vector2f Body::getInterpolatedPosition() const {
+    assert(m_body);
+    auto pos = gPhysicsModel().getInterpolatedPosition(m_body);
+    return { pos.x / PhysicsModel::BOX2D_SCALE, pos.y / PhysicsModel::BOX2D_SCALE };
+  }
+
+  float Body::getInterpolatedAngle() const {
+    assert(m_body);
+    return gPhysicsModel().getInterpolatedAngle(m_body);
+  }
+
   void Body::setAngleAndVelocity(float angle, float velocity) {
     assert(m_body);
     m_body->SetTransform(m_body->GetPosition(), angle);
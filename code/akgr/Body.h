@@ -46,6 +46,14 @@ namespace akgr {
 
     sf::Vector2f getPosition() const;
     float getAngle() const;
+    sf::Vector2f getVelocity() const;
+
+    /*
+     * The position and the angle at the time of the rendered frame, to be
+     * used for rendering only
+     */
+    sf::Vector2f getInterpolatedPosition() const;
+    float getInterpolatedAngle() const;
 
     void setAngleAndVelocity(float angle, float velocity);
 
@@ -68,9 +68,9 @@ namespace akgr {
 
   }
 
-  void Character::render(sf::RenderWindow& window) {
-    auto pos = m_body.getPosition();
-    auto angle = m_body.getAngle() / PI_2 * 90.0f;
+  void Character::render(game::RenderQueue& queue, int priority) {
+    auto pos = m_body.getInterpolatedPosition();
+    auto angle = m_body.getInterpolatedAngle() / PI_2 * 90.0f;
 
     if (hasDialog()) {
 
@@ -94,15 +94,28 @@ namespace akgr {
       circleShape.setOutlineColor(color);
       circleShape.setOrigin(DIALOG_RADIUS, DIALOG_RADIUS);
       circleShape.setPosition(pos);
-      window.draw(circleShape);
+
+      queue.addCustom(priority, [circleShape](sf::RenderTarget& target) {
+        target.draw(circleShape);
+      });
     }
 
-    sf::RectangleShape shape({ CHARACTER_WIDTH, CHARACTER_HEIGHT });
-    shape.setOrigin(CHARACTER_WIDTH / 2, CHARACTER_HEIGHT / 2);
-    shape.setFillColor(sf::Color(0xFF, 0x80, 0x00));
-    shape.setPosition(pos);
-    shape.setRotation(angle);
-    window.draw(shape);
+    // an untextured quad, batched with the other characters
+    sf::Transform transform;
+    transform.translate(pos);
+    transform.rotate(angle);
+    transform.translate(- CHARACTER_WIDTH / 2, - CHARACTER_HEIGHT / 2);
+
+    sf::Color color(0xFF, 0x80, 0x00);
+
+    sf::Vertex quad[4] = {
+      sf::Vertex(transform.transformPoint(0.0f, 0.0f), color),
+      sf::Vertex(transform.transformPoint(CHARACTER_WIDTH, 0.0f), color),
+      sf::Vertex(transform.transformPoint(CHARACTER_WIDTH, CHARACTER_HEIGHT), color),
+      sf::Vertex(transform.transformPoint(0.0f, CHARACTER_HEIGHT), color)
+    };
+
+    queue.addQuads(priority, nullptr, quad, 4);
   }
 
 
@@ -121,14 +134,22 @@ namespace akgr {
     auto index = m_characters.size();
     m_nameToCharacters.insert(std::make_pair(name, index));
     m_characters.emplace_back(std::move(name), loc, angle);
+    m_handles.push_back(m_index.addItem(index, m_characters.back().getLocation()));
     return &m_characters[index];
   }
 
   void CharacterManager::updateCharacterSearch() {
     std::size_t index = 0;
 
-    for (const auto& c : m_characters) {
+    // the characters may have been replaced by a saved game
+    m_nameToCharacters.clear();
+    m_index.clear();
+    m_handles.clear();
+
+    for (auto& c : m_characters) {
       m_nameToCharacters.insert(std::make_pair(c.getName(), index));
+      m_handles.push_back(m_index.addItem(index, c.getLocation()));
+      index++;
     }
   }
 
@@ -146,16 +167,19 @@ namespace akgr {
   void CharacterManager::update(float dt) {
     int floor = m_tracker.getFloor();
 
-    for (auto& c : m_characters) {
+    for (std::size_t i = 0; i < m_characters.size(); ++i) {
+      auto& c = m_characters[i];
+
       if (c.getLocation().floor != floor) {
         continue;
       }
 
       c.update(dt);
+      m_index.updateItem(m_handles[i], c.getLocation());
     }
   }
 
-  void CharacterManager::render(sf::RenderWindow& window) {
+  void CharacterManager::render(game::RenderQueue& queue) {
     int floor = m_tracker.getFloor();
 
     for (auto& c : m_characters) {
@@ -163,7 +187,7 @@ namespace akgr {
         continue;
       }
 
-      c.render(window);
+      c.render(queue, getPriority());
     }
   }
 
@@ -172,22 +196,15 @@ namespace akgr {
   game::EventStatus CharacterManager::onUse(game::EventType type, game::Event *event) {
     auto useEvent = static_cast<UseEvent *>(event);
 
-    for (auto& c : m_characters) {
+    for (auto index : m_index.queryItems(useEvent->loc, DIALOG_DISTANCE)) {
+      auto& c = m_characters[index];
+
       if (!c.hasDialog()) {
         continue;
       }
 
-      Location loc = c.getLocation();
-
-      if (loc.floor == useEvent->loc.floor) {
-        float d2 = squareDistance(loc.pos, useEvent->loc.pos);
-//         game::Log::info(game::Log::GENERAL, "Distance: %f\n", std::sqrt(d2));
-
-        if (d2 < DIALOG_DISTANCE * DIALOG_DISTANCE) {
-          useEvent->kind = UseEvent::TALK;
-          gDialogManager().start(c.getDialogName());
-        }
-      }
+      useEvent->kind = UseEvent::TALK;
+      gDialogManager().start(c.getDialogName());
     }
 
     return game::EventStatus::KEEP;
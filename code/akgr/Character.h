@@ -22,6 +22,7 @@
 
 #include <game/Entity.h>
 #include <game/Event.h>
+#include <game/RenderQueue.h>
 
 #include <boost/serialization/serialization.hpp>
 #include <boost/serialization/string.hpp>
@@ -29,6 +30,7 @@
 
 #include "Body.h"
 #include "FloorTracker.h"
+#include "ProximityIndex.h"
 
 namespace akgr {
 
@@ -57,7 +59,7 @@ namespace akgr {
     }
 
     void update(float dt);
-    void render(sf::RenderWindow& window);
+    void render(game::RenderQueue& queue, int priority);
 
   private:
     enum class Dialog : uint8_t {
@@ -96,12 +98,14 @@ namespace akgr {
     Character *getCharacter(const std::string& name);
 
     virtual void update(float dt) override;
-    virtual void render(sf::RenderWindow& window) override;
+    virtual void render(game::RenderQueue& queue) override;
 
   private:
     FloorTracker m_tracker;
     std::vector<Character> m_characters;
     std::map<std::string, std::size_t> m_nameToCharacters;
+    ProximityIndex m_index;
+    std::vector<std::size_t> m_handles;
 
   private:
     game::EventStatus onUse(game::EventType type, game::Event *event);
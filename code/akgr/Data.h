@@ -89,9 +89,6 @@ namespace akgr {
   };
 
   struct QuestData {
-    sf::String title;
-    sf::String goal;
-    sf::String description;
     QuestCategory category;
     QuestType type;
 
@@ -115,6 +112,12 @@ namespace akgr {
     std::string next;
   };
 
+  struct QuestTextData {
+    sf::String title;
+    sf::String goal;
+    sf::String description;
+  };
+
 }
 
 #endif // AKGR_DATA_H
@@ -0,0 +1,534 @@
+/*
+ * Akagoria, the revenge of Kalista
+ * a single-player RPG in an open world with a top-down view.
+ *
+ * Copyright (c) 2013-2015, Julien Bernard
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "DataBase.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/locale/message.hpp>
+
+#include <game/Log.h>
+
+namespace akgr {
+
+  static constexpr char DATABASE_MAGIC[8] = { 'A', 'K', 'G', 'R', 'D', 'B', '\0', '\0' };
+  static constexpr uint32_t DATABASE_BYTE_ORDER = 0x01020304;
+  static constexpr std::size_t ALIGNMENT = 8;
+
+  namespace {
+
+    struct Header {
+      char magic[8];
+      uint32_t version;
+      uint32_t byteOrder;
+      uint32_t collisionOffset;
+      uint32_t collisionCount;
+      uint32_t spriteOffset;
+      uint32_t spriteCount;
+      uint32_t itemOffset;
+      uint32_t itemCount;
+      uint32_t dialogOffset;
+      uint32_t dialogCount;
+      uint32_t lineOffset;
+      uint32_t lineCount;
+      uint32_t messageOffset;
+      uint32_t messageCount;
+      uint32_t questOffset;
+      uint32_t questCount;
+      uint32_t stringOffset;
+      uint32_t stringCount;
+      uint32_t languageOffset;
+      uint32_t languageCount;
+      uint32_t textOffset;
+      uint32_t textCount;
+    };
+
+    class Writer {
+    public:
+      Writer(std::vector<char>& buffer)
+      : m_buffer(buffer)
+      {
+      }
+
+      template<typename T>
+      uint32_t append(const T *data, std::size_t count) {
+        m_buffer.resize((m_buffer.size() + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT, '\0');
+        uint32_t offset = m_buffer.size();
+        const char *bytes = reinterpret_cast<const char *>(data);
+        m_buffer.insert(m_buffer.end(), bytes, bytes + count * sizeof(T));
+        return offset;
+      }
+
+    private:
+      std::vector<char>& m_buffer;
+    };
+
+    // the lookups by id need unique ids, a duplicate is a fatal error
+    template<typename T>
+    bool sortById(std::vector<T>& records, const char *kind, const std::vector<std::string>& strings) {
+      std::sort(records.begin(), records.end(), [](const T& lhs, const T& rhs) {
+        return lhs.id < rhs.id;
+      });
+
+      auto it = std::adjacent_find(records.begin(), records.end(), [](const T& lhs, const T& rhs) {
+        return lhs.id == rhs.id;
+      });
+
+      if (it != records.end()) {
+        game::Log::error(game::Log::RESOURCES, "Duplicate id in %s data: '%s' and '%s'\n", kind, strings[it->name].c_str(), strings[(it + 1)->name].c_str());
+        return false;
+      }
+
+      return true;
+    }
+
+    template<typename T>
+    bool isSortedById(const T *records, uint32_t count) {
+      return std::is_sorted(records, records + count, [](const T& lhs, const T& rhs) {
+        return lhs.id < rhs.id;
+      });
+    }
+
+  }
+
+  /*
+   * DataBase
+   */
+
+  DataBase::DataBase()
+  : m_data(nullptr)
+  , m_size(0)
+  , m_locale(0)
+  {
+
+  }
+
+  DataBase::~DataBase() {
+    // defined here for the destruction of the mapped region
+  }
+
+  bool DataBase::isUpToDate(const boost::filesystem::path& databasePath, const boost::filesystem::path& datadir, const boost::filesystem::path& localedir, const std::string& language) {
+    boost::system::error_code ec;
+
+    auto databaseTime = boost::filesystem::last_write_time(databasePath, ec);
+
+    if (ec) {
+      return false;
+    }
+
+    // a modified data file takes precedence over the data base
+    for (boost::filesystem::directory_iterator it(datadir, ec), end; !ec && it != end; it.increment(ec)) {
+      if (it->path().extension() != ".yml") {
+        continue;
+      }
+
+      auto dataTime = boost::filesystem::last_write_time(it->path(), ec);
+
+      if (ec || dataTime > databaseTime) {
+        return false;
+      }
+    }
+
+    if (ec) {
+      return false;
+    }
+
+    // the texts of the language are baked from its messages
+    if (!language.empty()) {
+      auto messagesPath = localedir / language / "LC_MESSAGES/akagoria.mo";
+
+      if (boost::filesystem::exists(messagesPath, ec)) {
+        auto messagesTime = boost::filesystem::last_write_time(messagesPath, ec);
+
+        if (ec || messagesTime > databaseTime) {
+          return false;
+        }
+      }
+    }
+
+    return true;
+  }
+
+  bool DataBase::loadFromFile(const boost::filesystem::path& path) {
+    try {
+      boost::interprocess::file_mapping file(path.string().c_str(), boost::interprocess::read_only);
+      m_region.reset(new boost::interprocess::mapped_region(file, boost::interprocess::read_only));
+    } catch (boost::interprocess::interprocess_exception& ex) {
+      game::Log::error(game::Log::RESOURCES, "Could not map the data base '%s': %s\n", path.string().c_str(), ex.what());
+      m_region.reset();
+      return false;
+    }
+
+    if (!setData(static_cast<const char *>(m_region->get_address()), m_region->get_size())) {
+      game::Log::warning(game::Log::RESOURCES, "Invalid data base: '%s'\n", path.string().c_str());
+      m_region.reset();
+      return false;
+    }
+
+    game::Log::info(game::Log::RESOURCES, "Data base loaded: '%s'\n", path.string().c_str());
+    return true;
+  }
+
+  bool DataBase::selectLanguage(const std::string& language) {
+    auto header = reinterpret_cast<const Header *>(m_data);
+    auto languages = getTable<uint32_t>(header->languageOffset, header->languageCount);
+
+    for (uint32_t i = 0; i < header->languageCount; ++i) {
+      if (language == getString(languages.begin()[i])) {
+        m_locale = i;
+        return true;
+      }
+    }
+
+    m_locale = 0;
+    return false;
+  }
+
+  DataBase::Table<DataBase::CollisionRecord> DataBase::getCollisions() const {
+    auto header = reinterpret_cast<const Header *>(m_data);
+    return getTable<CollisionRecord>(header->collisionOffset, header->collisionCount);
+  }
+
+  DataBase::Table<DataBase::SpriteRecord> DataBase::getSprites() const {
+    auto header = reinterpret_cast<const Header *>(m_data);
+    return getTable<SpriteRecord>(header->spriteOffset, header->spriteCount);
+  }
+
+  DataBase::Table<DataBase::ItemRecord> DataBase::getItems() const {
+    auto header = reinterpret_cast<const Header *>(m_data);
+    return getTable<ItemRecord>(header->itemOffset, header->itemCount);
+  }
+
+  DataBase::Table<DataBase::DialogRecord> DataBase::getDialogs() const {
+    auto header = reinterpret_cast<const Header *>(m_data);
+    return getTable<DialogRecord>(header->dialogOffset, header->dialogCount);
+  }
+
+  DataBase::Table<DataBase::LineRecord> DataBase::getLines(const DialogRecord& dialog) const {
+    auto header = reinterpret_cast<const Header *>(m_data);
+    auto lines = getTable<LineRecord>(header->lineOffset, header->lineCount);
+    return Table<LineRecord>(lines.begin() + dialog.firstLine, dialog.lineCount);
+  }
+
+  DataBase::Table<DataBase::MessageRecord> DataBase::getMessages() const {
+    auto header = reinterpret_cast<const Header *>(m_data);
+    return getTable<MessageRecord>(header->messageOffset, header->messageCount);
+  }
+
+  DataBase::Table<DataBase::QuestRecord> DataBase::getQuests() const {
+    auto header = reinterpret_cast<const Header *>(m_data);
+    return getTable<QuestRecord>(header->questOffset, header->questCount);
+  }
+
+  const char *DataBase::getString(uint32_t index) const {
+    auto header = reinterpret_cast<const Header *>(m_data);
+
+    if (index >= header->stringCount) {
+      return "";
+    }
+
+    auto offsets = getTable<uint32_t>(header->stringOffset, header->stringCount);
+    return m_data + offsets.begin()[index];
+  }
+
+  const char *DataBase::getText(uint32_t index) const {
+    auto header = reinterpret_cast<const Header *>(m_data);
+
+    if (index >= header->textCount) {
+      return "";
+    }
+
+    auto texts = getTable<uint32_t>(header->textOffset, header->languageCount * header->textCount);
+    return getString(texts.begin()[m_locale * header->textCount + index]);
+  }
+
+  template<typename T>
+  DataBase::Table<T> DataBase::getTable(uint32_t offset, uint32_t count) const {
+    assert(offset % ALIGNMENT == 0);
+    assert(offset + count * sizeof(T) <= m_size);
+    return Table<T>(reinterpret_cast<const T *>(m_data + offset), count);
+  }
+
+  static bool isInside(std::size_t size, uint32_t offset, std::size_t count, std::size_t elementSize) {
+    return offset % ALIGNMENT == 0 && offset <= size && count <= (size - offset) / elementSize;
+  }
+
+  bool DataBase::setData(const char *data, std::size_t size) {
+    m_data = nullptr;
+    m_size = 0;
+    m_locale = 0;
+
+    if (size < sizeof(Header)) {
+      return false;
+    }
+
+    auto header = reinterpret_cast<const Header *>(data);
+
+    if (std::memcmp(header->magic, DATABASE_MAGIC, sizeof DATABASE_MAGIC) != 0 || header->version != VERSION || header->byteOrder != DATABASE_BYTE_ORDER) {
+      return false;
+    }
+
+    if (!isInside(size, header->collisionOffset, header->collisionCount, sizeof(CollisionRecord))
+        || !isInside(size, header->spriteOffset, header->spriteCount, sizeof(SpriteRecord))
+        || !isInside(size, header->itemOffset, header->itemCount, sizeof(ItemRecord))
+        || !isInside(size, header->dialogOffset, header->dialogCount, sizeof(DialogRecord))
+        || !isInside(size, header->lineOffset, header->lineCount, sizeof(LineRecord))
+        || !isInside(size, header->messageOffset, header->messageCount, sizeof(MessageRecord))
+        || !isInside(size, header->questOffset, header->questCount, sizeof(QuestRecord))
+        || !isInside(size, header->stringOffset, header->stringCount, sizeof(uint32_t))
+        || !isInside(size, header->languageOffset, header->languageCount, sizeof(uint32_t))
+        || header->languageCount == 0
+        || !isInside(size, header->textOffset, std::size_t(header->languageCount) * header->textCount, sizeof(uint32_t))) {
+      return false;
+    }
+
+    // all the strings are terminated by the end of the file
+    if (header->stringCount > 0 && data[size - 1] != '\0') {
+      return false;
+    }
+
+    auto offsets = reinterpret_cast<const uint32_t *>(data + header->stringOffset);
+
+    for (uint32_t i = 0; i < header->stringCount; ++i) {
+      if (offsets[i] >= size) {
+        return false;
+      }
+    }
+
+    auto languages = reinterpret_cast<const uint32_t *>(data + header->languageOffset);
+
+    if (std::any_of(languages, languages + header->languageCount, [header](uint32_t index) { return index >= header->stringCount; })) {
+      return false;
+    }
+
+    auto texts = reinterpret_cast<const uint32_t *>(data + header->textOffset);
+
+    if (std::any_of(texts, texts + header->languageCount * header->textCount, [header](uint32_t index) { return index >= header->stringCount; })) {
+      return false;
+    }
+
+    auto dialogs = reinterpret_cast<const DialogRecord *>(data + header->dialogOffset);
+
+    for (uint32_t i = 0; i < header->dialogCount; ++i) {
+      if (dialogs[i].firstLine > header->lineCount || dialogs[i].lineCount > header->lineCount - dialogs[i].firstLine) {
+        return false;
+      }
+    }
+
+    if (!isSortedById(reinterpret_cast<const CollisionRecord *>(data + header->collisionOffset), header->collisionCount)
+        || !isSortedById(reinterpret_cast<const SpriteRecord *>(data + header->spriteOffset), header->spriteCount)
+        || !isSortedById(reinterpret_cast<const ItemRecord *>(data + header->itemOffset), header->itemCount)
+        || !isSortedById(dialogs, header->dialogCount)
+        || !isSortedById(reinterpret_cast<const MessageRecord *>(data + header->messageOffset), header->messageCount)
+        || !isSortedById(reinterpret_cast<const QuestRecord *>(data + header->questOffset), header->questCount)) {
+      return false;
+    }
+
+    m_data = data;
+    m_size = size;
+    return true;
+  }
+
+  /*
+   * DataBaseWriter
+   */
+
+  DataBaseWriter::DataBaseWriter() {
+    // the first language is for the untranslated texts
+    m_languages.emplace_back("", std::locale::classic());
+  }
+
+  void DataBaseWriter::addCollisionData(std::string name, const CollisionData& data) {
+    m_collisions.push_back({ game::Hash(name), addString(name), data });
+  }
+
+  void DataBaseWriter::addSpriteData(std::string name, SpriteData data) {
+    DataBase::SpriteRecord record;
+    record.id = game::Hash(name);
+    record.name = addString(name);
+    record.image = addString(data.image.string());
+    record.left = data.rectangle.left;
+    record.top = data.rectangle.top;
+    record.width = data.rectangle.width;
+    record.height = data.rectangle.height;
+    m_sprites.push_back(record);
+  }
+
+  void DataBaseWriter::addItemData(std::string name, ItemData data) {
+    m_items.push_back({ game::Hash(name), addString(name), addString(data.sprite), addString(data.collision) });
+  }
+
+  void DataBaseWriter::addDialogData(std::string name, const std::vector<DialogLineText>& content) {
+    m_dialogs.push_back({ game::Hash(name), addString(name), static_cast<uint32_t>(m_lines.size()), static_cast<uint32_t>(content.size()) });
+
+    for (auto& line : content) {
+      m_lines.push_back({ addString(line.speaker), addText(line.words) });
+    }
+  }
+
+  void DataBaseWriter::addMessageData(std::string name, const std::string& message) {
+    m_messages.push_back({ game::Hash(name), addString(name), addText(message) });
+  }
+
+  void DataBaseWriter::addQuestData(std::string name, const QuestData& data, const QuestText& text) {
+    DataBase::QuestRecord record;
+    record.id = game::Hash(name);
+    record.name = addString(name);
+    record.title = addText(text.title);
+    record.goal = addText(text.goal);
+    record.description = addText(text.description);
+    record.category = data.category;
+    record.type = data.type;
+    record.target = 0;
+    record.count = 0;
+
+    switch (data.type) {
+      case QuestType::EXPLORE:
+        record.target = data.explore.place;
+        break;
+      case QuestType::FARM:
+        record.target = data.farm.item;
+        record.count = data.farm.count;
+        break;
+      case QuestType::HUNT:
+        record.target = data.hunt.monster;
+        record.count = data.hunt.count;
+        break;
+      case QuestType::TALK:
+        record.target = data.talk.conversation;
+        break;
+    }
+
+    record.next = addString(data.next);
+    m_quests.push_back(record);
+  }
+
+  void DataBaseWriter::addLanguage(const std::string& language, const std::locale& locale) {
+    m_languages.emplace_back(language, locale);
+  }
+
+  uint32_t DataBaseWriter::addString(const std::string& str) {
+    auto it = m_stringIndices.find(str);
+
+    if (it != m_stringIndices.end()) {
+      return it->second;
+    }
+
+    uint32_t index = m_strings.size();
+    m_strings.push_back(str);
+    m_stringIndices.insert(std::make_pair(str, index));
+    return index;
+  }
+
+  uint32_t DataBaseWriter::addText(const std::string& text) {
+    uint32_t index = m_texts.size();
+    m_texts.push_back(text);
+    return index;
+  }
+
+  bool DataBaseWriter::saveToFile(const boost::filesystem::path& path) {
+    bool unique = sortById(m_collisions, "collision", m_strings);
+    unique = sortById(m_sprites, "sprite", m_strings) && unique;
+    unique = sortById(m_items, "item", m_strings) && unique;
+    unique = sortById(m_dialogs, "dialogue", m_strings) && unique;
+    unique = sortById(m_messages, "message", m_strings) && unique;
+    unique = sortById(m_quests, "quest", m_strings) && unique;
+
+    if (!unique) {
+      return false;
+    }
+
+    std::vector<uint32_t> languages;
+    std::vector<uint32_t> texts;
+
+    for (auto& language : m_languages) {
+      languages.push_back(addString(language.first));
+
+      for (auto& text : m_texts) {
+        if (language.first.empty() || text.empty()) {
+          texts.push_back(addString(text));
+        } else {
+          texts.push_back(addString(boost::locale::translate(text).str(language.second)));
+        }
+      }
+    }
+
+    std::vector<char> buffer;
+
+    Header header;
+    std::memset(&header, 0, sizeof header);
+
+    Writer writer(buffer);
+    writer.append(&header, 1);
+
+    std::memcpy(header.magic, DATABASE_MAGIC, sizeof DATABASE_MAGIC);
+    header.version = DataBase::VERSION;
+    header.byteOrder = DATABASE_BYTE_ORDER;
+    header.collisionOffset = writer.append(m_collisions.data(), m_collisions.size());
+    header.collisionCount = m_collisions.size();
+    header.spriteOffset = writer.append(m_sprites.data(), m_sprites.size());
+    header.spriteCount = m_sprites.size();
+    header.itemOffset = writer.append(m_items.data(), m_items.size());
+    header.itemCount = m_items.size();
+    header.dialogOffset = writer.append(m_dialogs.data(), m_dialogs.size());
+    header.dialogCount = m_dialogs.size();
+    header.lineOffset = writer.append(m_lines.data(), m_lines.size());
+    header.lineCount = m_lines.size();
+    header.messageOffset = writer.append(m_messages.data(), m_messages.size());
+    header.messageCount = m_messages.size();
+    header.questOffset = writer.append(m_quests.data(), m_quests.size());
+    header.questCount = m_quests.size();
+    header.languageOffset = writer.append(languages.data(), languages.size());
+    header.languageCount = languages.size();
+    header.textOffset = writer.append(texts.data(), texts.size());
+    header.textCount = m_texts.size();
+
+    // the characters of the strings are at the end of the file
+    std::vector<uint32_t> stringOffsets(m_strings.size(), 0);
+    header.stringOffset = writer.append(stringOffsets.data(), stringOffsets.size());
+    header.stringCount = stringOffsets.size();
+
+    for (std::size_t i = 0; i < m_strings.size(); ++i) {
+      const std::string& str = m_strings[i];
+      stringOffsets[i] = writer.append(str.c_str(), str.size() + 1);
+    }
+
+    if (!stringOffsets.empty()) {
+      std::memcpy(buffer.data() + header.stringOffset, stringOffsets.data(), stringOffsets.size() * sizeof(uint32_t));
+    }
+
+    std::memcpy(buffer.data(), &header, sizeof header);
+
+    std::ofstream file(path.string(), std::ios::binary);
+    file.write(buffer.data(), buffer.size());
+
+    if (!file) {
+      game::Log::error(game::Log::RESOURCES, "Could not write the data base: '%s'\n", path.string().c_str());
+      return false;
+    }
+
+    return true;
+  }
+
+}
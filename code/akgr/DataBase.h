@@ -0,0 +1,237 @@
+/*
+ * Akagoria, the revenge of Kalista
+ * a single-player RPG in an open world with a top-down view.
+ *
+ * Copyright (c) 2013-2015, Julien Bernard
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef AKGR_DATA_BASE_H
+#define AKGR_DATA_BASE_H
+
+#include <cstdint>
+#include <algorithm>
+#include <locale>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include <game/Id.h>
+
+#include "Data.h"
+#include "DataParser.h"
+
+namespace boost {
+  namespace interprocess {
+    class mapped_region;
+  }
+}
+
+namespace akgr {
+
+  /*
+   * A compiled version of the data files.
+   *
+   * All the records are sorted by id. The names, paths and speakers are in a
+   * string table. The texts that must be translated have one table for each
+   * locale, the first one being the untranslated texts.
+   */
+  class DataBase {
+  public:
+    static constexpr uint32_t VERSION = 1;
+
+    struct CollisionRecord {
+      game::Id id;
+      uint32_t name;
+      CollisionData data;
+    };
+
+    struct SpriteRecord {
+      game::Id id;
+      uint32_t name;
+      uint32_t image;
+      int32_t left;
+      int32_t top;
+      int32_t width;
+      int32_t height;
+    };
+
+    struct ItemRecord {
+      game::Id id;
+      uint32_t name;
+      uint32_t sprite;
+      uint32_t collision;
+    };
+
+    struct DialogRecord {
+      game::Id id;
+      uint32_t name;
+      uint32_t firstLine;
+      uint32_t lineCount;
+    };
+
+    struct LineRecord {
+      uint32_t speaker; // string
+      uint32_t words; // text
+    };
+
+    struct MessageRecord {
+      game::Id id;
+      uint32_t name;
+      uint32_t message; // text
+    };
+
+    struct QuestRecord {
+      game::Id id;
+      uint32_t name;
+      uint32_t title; // text
+      uint32_t goal; // text
+      uint32_t description; // text
+      QuestCategory category;
+      QuestType type;
+      game::Id target;
+      uint32_t count;
+      uint32_t next;
+    };
+
+    template<typename T>
+    class Table {
+    public:
+      Table(const T *first, std::size_t size)
+      : m_first(first)
+      , m_size(size)
+      {
+      }
+
+      const T *begin() const {
+        return m_first;
+      }
+
+      const T *end() const {
+        return m_first + m_size;
+      }
+
+      std::size_t size() const {
+        return m_size;
+      }
+
+      const T *find(game::Id id) const {
+        auto it = std::lower_bound(begin(), end(), id, [](const T& record, game::Id id) {
+          return record.id < id;
+        });
+
+        if (it == end() || it->id != id) {
+          return nullptr;
+        }
+
+        return it;
+      }
+
+    private:
+      const T *m_first;
+      std::size_t m_size;
+    };
+
+    DataBase();
+    ~DataBase();
+
+    DataBase(const DataBase&) = delete;
+    DataBase& operator=(const DataBase&) = delete;
+
+    /*
+     * The data base is up to date if it is newer than the data files and
+     * than the translations of the language
+     */
+    static bool isUpToDate(const boost::filesystem::path& databasePath, const boost::filesystem::path& datadir, const boost::filesystem::path& localedir, const std::string& language);
+
+    bool loadFromFile(const boost::filesystem::path& path);
+
+    /*
+     * Select the texts for a language, return false if the language is not
+     * available (then, the untranslated texts are used).
+     */
+    bool selectLanguage(const std::string& language);
+
+    Table<CollisionRecord> getCollisions() const;
+    Table<SpriteRecord> getSprites() const;
+    Table<ItemRecord> getItems() const;
+    Table<DialogRecord> getDialogs() const;
+    Table<LineRecord> getLines(const DialogRecord& dialog) const;
+    Table<MessageRecord> getMessages() const;
+    Table<QuestRecord> getQuests() const;
+
+    const char *getString(uint32_t index) const;
+    const char *getText(uint32_t index) const;
+
+  private:
+    bool setData(const char *data, std::size_t size);
+
+    template<typename T>
+    Table<T> getTable(uint32_t offset, uint32_t count) const;
+
+  private:
+    std::unique_ptr<boost::interprocess::mapped_region> m_region;
+    const char *m_data;
+    std::size_t m_size;
+    uint32_t m_locale;
+  };
+
+  /*
+   * The compiler of the data base.
+   */
+  class DataBaseWriter : public DataSink {
+  public:
+    DataBaseWriter();
+
+    virtual void addCollisionData(std::string name, const CollisionData& data) override;
+    virtual void addSpriteData(std::string name, SpriteData data) override;
+    virtual void addItemData(std::string name, ItemData data) override;
+    virtual void addDialogData(std::string name, const std::vector<DialogLineText>& content) override;
+    virtual void addMessageData(std::string name, const std::string& message) override;
+    virtual void addQuestData(std::string name, const QuestData& data, const QuestText& text) override;
+
+    void addLanguage(const std::string& language, const std::locale& locale);
+
+    /*
+     * Write the data base, nothing is written if two records of a kind have
+     * the same id (e.g. a collision of the hashes of their names)
+     */
+    bool saveToFile(const boost::filesystem::path& path);
+
+  private:
+    uint32_t addString(const std::string& str);
+    uint32_t addText(const std::string& text);
+
+  private:
+    std::vector<DataBase::CollisionRecord> m_collisions;
+    std::vector<DataBase::SpriteRecord> m_sprites;
+    std::vector<DataBase::ItemRecord> m_items;
+    std::vector<DataBase::DialogRecord> m_dialogs;
+    std::vector<DataBase::LineRecord> m_lines;
+    std::vector<DataBase::MessageRecord> m_messages;
+    std::vector<DataBase::QuestRecord> m_quests;
+
+    std::vector<std::string> m_strings;
+    std::map<std::string, uint32_t> m_stringIndices;
+
+    std::vector<std::string> m_texts;
+    std::vector<std::pair<std::string, std::locale>> m_languages;
+  };
+
+}
+
+#endif // AKGR_DATA_BASE_H
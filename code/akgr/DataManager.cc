@@ -19,12 +19,16 @@
  */
 #include "DataManager.h"
 
-#include <boost/locale.hpp>
+#include <cassert>
+#include <cinttypes>
+#include <cstring>
 
-#include <tmx/ObjectLayer.h>
-#include <yaml-cpp/yaml.h>
+#include <boost/locale.hpp>
 
 #include <game/Log.h>
+#include <game/Profiler.h>
+
+#include "DataBase.h"
 
 namespace akgr {
 
@@ -40,571 +44,455 @@ namespace akgr {
     return convertString(translatedString);
   }
 
-  static void loadCollisionData(std::map<std::string, CollisionData>& collisions, const std::string& path) {
-    try {
-      YAML::Node node = YAML::LoadFile(path);
-
-      assert(node.IsMap());
-
-      for (const auto& entry : node) {
-        std::string name = entry.first.as<std::string>();
-        auto properties = entry.second;
-
-        assert(properties.IsMap());
-
-        auto typeNode = properties["type"];
-
-        if (!typeNode) {
-          game::Log::warning(game::Log::RESOURCES, "Missing type for entry: '%s'\n", name.c_str());
-          continue;
-        }
-
-        std::string type = typeNode.as<std::string>();
-
-        CollisionData data;
+  static game::Id hashString(const char *str) {
+    std::size_t size = std::strlen(str);
+    return game::Hash(str, size, size);
+  }
 
-        if (type == "circle") {
-          data.shape = CollisionShape::CIRCLE;
+  static QuestData convertQuestRecord(const DataBase& database, const DataBase::QuestRecord& record) {
+    QuestData data;
+    data.category = record.category;
+    data.type = record.type;
+
+    switch (record.type) {
+      case QuestType::EXPLORE:
+        data.explore.place = record.target;
+        break;
+      case QuestType::FARM:
+        data.farm.item = record.target;
+        data.farm.count = record.count;
+        break;
+      case QuestType::HUNT:
+        data.hunt.monster = record.target;
+        data.hunt.count = record.count;
+        break;
+      case QuestType::TALK:
+        data.talk.conversation = record.target;
+        break;
+    }
 
-          auto radiusNode = properties["radius"];
-          assert(radiusNode);
+    data.next = database.getString(record.next);
+    return data;
+  }
 
-          data.circle.radius = radiusNode.as<float>();
+  static constexpr std::size_t DIALOG_CACHE_SIZE = 8;
+  static constexpr std::size_t QUEST_TEXT_CACHE_SIZE = 16;
 
-        } else {
-          game::Log::warning(game::Log::RESOURCES, "Unknown type for entry: '%s'\n", name.c_str());
-          continue;
-        }
+  // a table of the data files or of the data base
+  template<typename Table>
+  static auto findData(const Table& table, game::Id id, const char *kind, const char *name) -> decltype(table.find(id)) {
+    auto data = table.find(id);
 
-        collisions.emplace(std::move(name), data);
+    if (data == nullptr) {
+      if (name != nullptr) {
+        game::Log::warning(game::Log::RESOURCES, "Could not find %s data for '%s'\n", kind, name);
+      } else {
+        game::Log::warning(game::Log::RESOURCES, "Could not find %s data for id %#" PRIx64 "\n", kind, id);
       }
-    } catch (std::exception& ex) {
-      game::Log::error(game::Log::RESOURCES, "Error when loading collision database: %s\n", ex.what());
-      return;
     }
-  }
-
-  static void loadSpriteData(std::map<std::string, SpriteData>& sprites, const std::string& path) {
-    try {
-      YAML::Node node = YAML::LoadFile(path);
-
-      assert(node.IsMap());
-
-      for (const auto& entry : node) {
-        std::string name = entry.first.as<std::string>();
-        auto properties = entry.second;
-
-        assert(properties.IsMap());
-
-        auto imageNode = properties["image"];
-
-        if (!imageNode) {
-          game::Log::warning(game::Log::RESOURCES, "Missing image for entry: '%s'\n", name.c_str());
-          continue;
-        }
-
-        std::string image = imageNode.as<std::string>();
-
-        auto dimensionNode = properties["dimension"];
 
-        if (!dimensionNode) {
-          game::Log::warning(game::Log::RESOURCES, "Missing dimension for entry: '%s'\n", name.c_str());
-          continue;
-        }
-
-        assert(dimensionNode.IsMap());
-
-        int width = dimensionNode["width"].as<int>();
-        assert(width > 0);
-        int height = dimensionNode["height"].as<int>();
-        assert(height > 0);
-
-        auto spriteNode = properties["sprite"];
-
-        if (!spriteNode) {
-          game::Log::warning(game::Log::RESOURCES, "Missing sprite for entry: '%s'\n", name.c_str());
-          continue;
-        }
-
-        assert(spriteNode.IsMap());
-
-        int spriteWidth = spriteNode["width"].as<int>();
-        assert(spriteWidth > 0);
-        int spriteHeight = spriteNode["height"].as<int>();
-        assert(spriteHeight > 0);
-
-        assert(width % spriteWidth == 0);
-        assert(height % spriteHeight == 0);
-
-        int count = width / spriteWidth;
-        assert(count > 0);
-
-        auto ids_node = properties["ids"];
-
-        unsigned k = 0;
-
-        for (auto id : ids_node) {
-          std::string name = id.as<std::string>();
-
-          int left = (k % count) * spriteWidth;
-          int top = (k / count) * spriteHeight;
-
-          SpriteData data;
-          data.image = image;
-          data.rectangle = { left, top, spriteWidth, spriteHeight };
+    return data;
+  }
 
-          sprites.emplace(std::move(name), std::move(data));
+  template<typename T>
+  static void sortTable(DataTable<T>& table, const char *kind) {
+    std::size_t duplicates = table.sort();
 
-        }
-      }
-    } catch (std::exception& ex) {
-      game::Log::error(game::Log::RESOURCES, "Error when loading sprite database: %s\n", ex.what());
-      return;
+    if (duplicates > 0) {
+      game::Log::warning(game::Log::RESOURCES, "Duplicate %s data: %zu, the first ones are kept\n", kind, duplicates);
     }
   }
 
-  static void loadItemData(std::map<std::string, ItemData>& items, const std::string& path) {
-    try {
-      YAML::Node node = YAML::LoadFile(path);
-
-      assert(node.IsMap());
-
-      for (const auto& entry : node) {
-        std::string name = entry.first.as<std::string>();
-        auto properties = entry.second;
+  DataManager::DataManager()
+  : m_dialogCache(DIALOG_CACHE_SIZE)
+  , m_questTextCache(QUEST_TEXT_CACHE_SIZE)
+  {
+  }
 
-        ItemData data;
+  DataManager::~DataManager() {
+    // defined here for the destruction of the data base
+  }
 
-        assert(properties.IsMap());
+  void DataManager::load(const boost::filesystem::path& basedir, const boost::filesystem::path& localedir, const boost::filesystem::path& buildDatabasePath) {
+    game::ProfileScope scope("DataManager::load");
+    game::Log::info(game::Log::RESOURCES, "Loading data\n");
 
-        auto spriteNode = properties["sprite"];
+    std::locale locale;
+    std::string language;
 
-        if (!spriteNode) {
-          game::Log::warning(game::Log::RESOURCES, "Missing sprite for entry: '%s'\n", name.c_str());
-          continue;
-        }
+    if (std::has_facet<boost::locale::info>(locale)) {
+      language = std::use_facet<boost::locale::info>(locale).language();
+    }
 
-        data.sprite = spriteNode.as<std::string>();
+    std::unique_ptr<DataBase> database(new DataBase);
+    boost::filesystem::path datadir = basedir / "data";
 
-        auto collisionNode = properties["collision"];
+    auto isLoaded = [&](const boost::filesystem::path& candidate) {
+      return DataBase::isUpToDate(candidate, datadir, localedir, language) && database->loadFromFile(candidate);
+    };
 
-        if (!collisionNode) {
-          game::Log::warning(game::Log::RESOURCES, "Missing collision for entry: '%s'\n", name.c_str());
-          continue;
-        }
+    if (isLoaded(datadir / "akagoria.akdb") || isLoaded(buildDatabasePath)) {
+      if (!database->selectLanguage(language)) {
+        game::Log::warning(game::Log::RESOURCES, "No texts for language '%s' in the data base\n", language.c_str());
+      }
 
-        data.collision = collisionNode.as<std::string>();
+      m_database = std::move(database);
 
-        items.emplace(std::move(name), std::move(data));
-      }
-    } catch (std::exception& ex) {
-      game::Log::error(game::Log::RESOURCES, "Error when loading item database: %s\n", ex.what());
+      game::Log::info(game::Log::RESOURCES, "\tCollision data: %zu\n", m_database->getCollisions().size());
+      game::Log::info(game::Log::RESOURCES, "\tSprite data: %zu\n", m_database->getSprites().size());
+      game::Log::info(game::Log::RESOURCES, "\tItem data: %zu\n", m_database->getItems().size());
+      game::Log::info(game::Log::RESOURCES, "\tDialog data: %zu\n", m_database->getDialogs().size());
+      game::Log::info(game::Log::RESOURCES, "\tMessage data: %zu\n", m_database->getMessages().size());
+      game::Log::info(game::Log::RESOURCES, "\tQuest data: %zu\n", m_database->getQuests().size());
       return;
     }
-  }
-
-  static void loadDialogData(std::map<std::string, DialogData>& dialogues, const std::string& path) {
-    try {
-      YAML::Node node = YAML::LoadFile(path);
-
-      assert(node.IsMap());
-
-      for (const auto& entry : node) {
-        std::string name = entry.first.as<std::string>();
-        auto properties = entry.second;
-
-        DialogData data;
-
-        assert(properties.IsMap());
-
-        auto contentNode = properties["content"];
-
-        if (!contentNode) {
-          game::Log::warning(game::Log::RESOURCES, "Missing content for entry: '%s'\n", name.c_str());
-          continue;
-        }
-
-        assert(contentNode.IsSequence());
 
-        for (const auto& lineNode : contentNode) {
-          auto speakerNode = lineNode["speaker"];
-          assert(speakerNode);
-          auto speaker = convertString(speakerNode.as<std::string>());
+    game::Log::info(game::Log::RESOURCES, "No valid data base, parsing the data files\n");
+    parseDataFiles(basedir, *this);
+    sortTables();
+    resolveItems();
 
-          auto wordsNode = lineNode["words"];
-          assert(wordsNode);
-          auto words = convertLocalString(wordsNode.as<std::string>());
+    game::Log::info(game::Log::RESOURCES, "\tCollision data: %zu\n", m_collisions.size());
+    game::Log::info(game::Log::RESOURCES, "\tSprite data: %zu\n", m_sprites.size());
+    game::Log::info(game::Log::RESOURCES, "\tItem data: %zu\n", m_items.size());
+    game::Log::info(game::Log::RESOURCES, "\tDialog data: %zu\n", m_dialogues.size());
+    game::Log::info(game::Log::RESOURCES, "\tMessage data: %zu\n", m_messages.size());
+    game::Log::info(game::Log::RESOURCES, "\tQuest data: %zu\n", m_quests.size());
+    game::Log::info(game::Log::RESOURCES, "\tText size: %zu\n", m_texts.size());
+  }
 
-          data.content.push_back({ std::move(speaker), std::move(words) });
-        }
+  void DataManager::sortTables() {
+    sortTable(m_collisions, "collision");
+    sortTable(m_sprites, "sprite");
+    sortTable(m_items, "item");
+    sortTable(m_dialogues, "dialogue");
+    sortTable(m_messages, "message");
+    sortTable(m_quests, "quest");
+  }
 
-        dialogues.emplace(std::move(name), std::move(data));
-      }
-    } catch (std::exception& ex) {
-      game::Log::error(game::Log::RESOURCES, "Error when loading dialog database: %s\n", ex.what());
-      return;
+  void DataManager::resolveItems() {
+    // the collision and sprite tables do not change after loading
+    for (auto& entry : m_items) {
+      entry.data.spriteData = findData(m_sprites, entry.data.sprite, "sprite", nullptr);
+      entry.data.collisionData = findData(m_collisions, entry.data.collision, "collision", nullptr);
     }
   }
 
-  static void loadMessageData(std::map<std::string, MessageData>& messages, const std::string& path) {
-    try {
-      YAML::Node node = YAML::LoadFile(path);
-
-      assert(node.IsMap());
+  void DataManager::addCollisionData(std::string name, const CollisionData& data) {
+    m_collisions.add(game::Hash(name), data);
+  }
 
-      for (const auto& entry : node) {
-        std::string name = entry.first.as<std::string>();
-        auto properties = entry.second;
+  void DataManager::addSpriteData(std::string name, SpriteData data) {
+    m_sprites.add(game::Hash(name), std::move(data));
+  }
 
-        MessageData data;
+  void DataManager::addItemData(std::string name, ItemData data) {
+    m_items.add(game::Hash(name), { game::Hash(data.sprite), game::Hash(data.collision), nullptr, nullptr });
+  }
 
-        assert(properties.IsMap());
+  uint32_t DataManager::addText(const std::string& text) {
+    uint32_t offset = m_texts.size();
+    m_texts.append(text);
+    m_texts.push_back('\0');
+    return offset;
+  }
 
-        auto messageNode = properties["message"];
+  sf::String DataManager::getText(uint32_t offset, bool translate) const {
+    assert(offset < m_texts.size());
+    std::string text(m_texts.c_str() + offset);
+    return translate ? convertLocalString(text) : convertString(text);
+  }
 
-        if (!messageNode) {
-          game::Log::warning(game::Log::RESOURCES, "Missing message for entry: '%s'\n", name.c_str());
-          continue;
-        }
+  void DataManager::addDialogData(std::string name, const std::vector<DialogLineText>& content) {
+    DialogEntry entry;
+    entry.firstLine = m_lines.size();
+    entry.lineCount = content.size();
 
-        data.message = convertLocalString(messageNode.as<std::string>());
+    m_dialogues.add(game::Hash(name), entry);
 
-        messages.emplace(std::move(name), std::move(data));
-      }
-    } catch (std::exception& ex) {
-      game::Log::error(game::Log::RESOURCES, "Error when loading message database: %s\n", ex.what());
-      return;
+    for (auto& line : content) {
+      m_lines.push_back({ addText(line.speaker), addText(line.words) });
     }
   }
 
-  static void loadQuestData(std::map<std::string, QuestData>& quests, const std::string& path) {
-    try {
-      YAML::Node node = YAML::LoadFile(path);
-
-      assert(node.IsMap());
-
-      for (const auto& entry : node) {
-        std::string name = entry.first.as<std::string>();
-        auto properties = entry.second;
-
-        QuestData data;
-
-        assert(properties.IsMap());
-
-        auto titleNode = properties["title"];
-
-        if (!titleNode) {
-          game::Log::warning(game::Log::RESOURCES, "Missing title for entry: '%s'\n", name.c_str());
-          continue;
-        }
-
-        data.title = convertLocalString(titleNode.as<std::string>());
+  void DataManager::addMessageData(std::string name, const std::string& message) {
+    MessageData data;
+    data.message = convertLocalString(message);
+    m_messages.add(game::Hash(name), std::move(data));
+  }
 
-        auto goalNode = properties["goal"];
+  void DataManager::addQuestData(std::string name, const QuestData& data, const QuestText& text) {
+    QuestEntry entry;
+    entry.data = data;
+    entry.title = addText(text.title);
+    entry.goal = addText(text.goal);
+    entry.description = addText(text.description);
+    m_quests.add(game::Hash(name), std::move(entry));
+  }
 
-        if (!goalNode) {
-          game::Log::warning(game::Log::RESOURCES, "Missing goal for entry: '%s'\n", name.c_str());
-          continue;
-        }
+  void DataManager::loadLayer(const MapCache& cache, const MapCache::Layer& layer) {
+    assert(layer.type == MapCache::LayerType::POI);
 
-        data.goal = convertLocalString(goalNode.as<std::string>());
+    int floor = layer.floor;
 
-        auto descriptionNode = properties["description"];
+    game::Log::info(game::Log::RESOURCES, "Loading POI layer: '%s' (floor: %i)\n", cache.getString(layer.name), floor);
 
-        if (!descriptionNode) {
-          game::Log::warning(game::Log::RESOURCES, "Missing description for entry: '%s'\n", name.c_str());
-          continue;
-        }
+    const MapCache::PointOfInterestRecord *pois = cache.getPointsOfInterest(layer);
 
-        data.description = convertLocalString(descriptionNode.as<std::string>());
+    for (uint32_t i = 0; i < layer.count; ++i) {
+      sf::Vector2f pos(pois[i].x, pois[i].y);
+      m_pois.add(game::Hash(cache.getString(pois[i].name)), PointOfInterestData{ { pos, floor } });
+    }
 
-        auto categoryNode = properties["category"];
+    sortTable(m_pois, "point of interest");
 
-        if (!categoryNode) {
-          game::Log::warning(game::Log::RESOURCES, "Missing category for entry: '%s'\n", name.c_str());
-          continue;
-        }
+    game::Log::info(game::Log::RESOURCES, "\tPOI loaded: %u\n", layer.count);
+  }
 
-        std::string category = categoryNode.as<std::string>();
+  const CollisionData *DataManager::getCollision(game::Id id, const char *name) const {
+    if (m_database) {
+      auto record = findData(m_database->getCollisions(), id, "collision", name);
+      return record != nullptr ? &record->data : nullptr;
+    }
 
-        if (category == "history") {
-          data.category = QuestCategory::HISTORY;
-        } else if (category == "short") {
-          data.category = QuestCategory::SHORT;
-        } else if (category == "medium") {
-          data.category = QuestCategory::MEDIUM;
-        } else if (category == "long") {
-          data.category = QuestCategory::LONG;
-        } else {
-          game::Log::warning(game::Log::RESOURCES, "Unknown category for entry: '%s'\n", name.c_str());
-          continue;
-        }
+    return findData(m_collisions, id, "collision", name);
+  }
 
-        auto parametersNode = properties["parameters"];
+  const CollisionData *DataManager::getCollisionDataFor(const std::string& name) const {
+    return getCollision(game::Hash(name), name.c_str());
+  }
 
-        if (!parametersNode) {
-          game::Log::warning(game::Log::RESOURCES, "Missing parameters for entry: '%s'\n", name.c_str());
-          continue;
-        }
+  const CollisionData *DataManager::getCollisionDataFor(game::Id id) const {
+    return getCollision(id, nullptr);
+  }
 
-        assert(parametersNode.IsMap());
+  const CollisionData *DataManager::findCollisionDataFor(game::Id id) const {
+    if (m_database) {
+      auto record = m_database->getCollisions().find(id);
+      return record != nullptr ? &record->data : nullptr;
+    }
 
-        auto typeNode = properties["type"];
+    return m_collisions.find(id);
+  }
 
-        if (!typeNode) {
-          game::Log::warning(game::Log::RESOURCES, "Missing type for entry: '%s'\n", name.c_str());
-          continue;
-        }
+  const SpriteData *DataManager::getSprite(game::Id id, const char *name) const {
+    if (!m_database) {
+      return findData(m_sprites, id, "sprite", name);
+    }
 
-        std::string type = typeNode.as<std::string>();
+    auto it = m_spriteCache.find(id);
 
-        if (type == "explore") {
-          data.type = QuestType::EXPLORE;
+    if (it != m_spriteCache.end()) {
+      return &it->second;
+    }
 
-          auto placeNode = parametersNode["place"];
+    auto record = findData(m_database->getSprites(), id, "sprite", name);
 
-          if (!placeNode) {
-            game::Log::warning(game::Log::RESOURCES, "Missing place for entry: '%s'\n", name.c_str());
-            continue;
-          }
+    if (record == nullptr) {
+      return nullptr;
+    }
 
-          data.explore.place = game::Hash(placeNode.as<std::string>());
+    SpriteData data;
+    data.image = m_database->getString(record->image);
+    data.rectangle = { record->left, record->top, record->width, record->height };
+    return &m_spriteCache.insert(std::make_pair(id, std::move(data))).first->second;
+  }
 
-        } else if (type == "farm") {
-          data.type = QuestType::FARM;
+  const SpriteData *DataManager::getSpriteDataFor(const std::string& name) const {
+    return getSprite(game::Hash(name), name.c_str());
+  }
 
-          auto itemNode = parametersNode["item"];
+  const SpriteData *DataManager::getSpriteDataFor(game::Id id) const {
+    return getSprite(id, nullptr);
+  }
 
-          if (!itemNode) {
-            game::Log::warning(game::Log::RESOURCES, "Missing item for entry: '%s'\n", name.c_str());
-            continue;
-          }
+  std::tuple<const CollisionData *, const SpriteData *> DataManager::getItem(game::Id id, const char *name) const {
+    if (m_database) {
+      auto record = findData(m_database->getItems(), id, "item", name);
 
-          data.farm.item = game::Hash(itemNode.as<std::string>());
+      if (record == nullptr) {
+        return std::make_tuple(nullptr, nullptr);
+      }
 
-          auto countNode = parametersNode["count"];
+      auto collision = getCollision(hashString(m_database->getString(record->collision)), nullptr);
+      auto sprite = getSprite(hashString(m_database->getString(record->sprite)), nullptr);
+      return std::make_tuple(collision, sprite);
+    }
 
-          if (!countNode) {
-            game::Log::warning(game::Log::RESOURCES, "Missing count for entry: '%s'\n", name.c_str());
-            continue;
-          }
+    auto entry = findData(m_items, id, "item", name);
 
-          data.farm.count = countNode.as<unsigned>();
+    if (entry == nullptr) {
+      return std::make_tuple(nullptr, nullptr);
+    }
 
-        } else if (type == "hunt") {
-          data.type = QuestType::HUNT;
+    return std::make_tuple(entry->collisionData, entry->spriteData);
+  }
 
-          auto monsterNode = parametersNode["monster"];
+  std::tuple<const CollisionData *, const SpriteData *> DataManager::getItemDataFor(const std::string& name) const {
+    return getItem(game::Hash(name), name.c_str());
+  }
 
-          if (!monsterNode) {
-            game::Log::warning(game::Log::RESOURCES, "Missing monster for entry: '%s'\n", name.c_str());
-            continue;
-          }
+  std::tuple<const CollisionData *, const SpriteData *> DataManager::getItemDataFor(game::Id id) const {
+    return getItem(id, nullptr);
+  }
 
-          data.hunt.monster = game::Hash(monsterNode.as<std::string>());
+  const PointOfInterestData *DataManager::getPointOfInterestDataFor(const std::string& name) const {
+    return findData(m_pois, game::Hash(name), "point of interest", name.c_str());
+  }
 
-          auto countNode = parametersNode["count"];
+  const PointOfInterestData *DataManager::getPointOfInterestDataFor(game::Id id) const {
+    return findData(m_pois, id, "point of interest", nullptr);
+  }
 
-          if (!countNode) {
-            game::Log::warning(game::Log::RESOURCES, "Missing count for entry: '%s'\n", name.c_str());
-            continue;
-          }
+  const DialogData *DataManager::getDialog(game::Id id, const char *name) const {
+    const DialogData *data = m_dialogCache.find(id);
 
-          data.hunt.count = countNode.as<unsigned>();
+    if (data != nullptr) {
+      return data;
+    }
 
-        } else if (type == "talk") {
-          data.type = QuestType::TALK;
+    DialogData dialog;
 
-          auto conversationNode = parametersNode["conversation"];
+    if (m_database) {
+      // the texts of the data base are already translated
+      auto record = findData(m_database->getDialogs(), id, "dialogue", name);
 
-          if (!conversationNode) {
-            game::Log::warning(game::Log::RESOURCES, "Missing conversation for entry: '%s'\n", name.c_str());
-            continue;
-          }
+      if (record == nullptr) {
+        return nullptr;
+      }
 
-          data.talk.conversation = game::Hash(conversationNode.as<std::string>());
+      auto lines = m_database->getLines(*record);
+      dialog.content.reserve(lines.size());
 
-        } else {
-          game::Log::warning(game::Log::RESOURCES, "Unknown type for entry: '%s'\n", name.c_str());
-          continue;
-        }
+      for (auto& line : lines) {
+        dialog.content.push_back({ convertString(m_database->getString(line.speaker)), convertString(m_database->getText(line.words)) });
+      }
+    } else {
+      auto entry = findData(m_dialogues, id, "dialogue", name);
 
-        auto nextNode = properties["next"];
+      if (entry == nullptr) {
+        return nullptr;
+      }
 
-        if (nextNode) {
-          data.next = nextNode.as<std::string>();
-        }
+      dialog.content.reserve(entry->lineCount);
 
-        quests.emplace(std::move(name), std::move(data));
+      for (uint32_t i = entry->firstLine; i < entry->firstLine + entry->lineCount; ++i) {
+        const LineEntry& line = m_lines[i];
+        dialog.content.push_back({ getText(line.speaker, false), getText(line.words, true) });
       }
-    } catch (std::exception& ex) {
-      game::Log::error(game::Log::RESOURCES, "Error when loading quest database: %s\n", ex.what());
-      return;
     }
-  }
-
-  void DataManager::load(const boost::filesystem::path& basedir) {
-    game::Log::info(game::Log::RESOURCES, "Loading data\n");
-
-    boost::filesystem::path collisionsPath = basedir / "data/collisions.yml";
-    loadCollisionData(m_collisions, collisionsPath.string());
-    game::Log::info(game::Log::RESOURCES, "\tCollision data: %zu\n", m_collisions.size());
-
-    boost::filesystem::path spritesPath = basedir / "data/sprites.yml";
-    loadSpriteData(m_sprites, spritesPath.string());
-    game::Log::info(game::Log::RESOURCES, "\tSprite data: %zu\n", m_sprites.size());
 
-    boost::filesystem::path itemsPath = basedir / "data/items.yml";
-    loadItemData(m_items, itemsPath.string());
-    game::Log::info(game::Log::RESOURCES, "\tItem data: %zu\n", m_items.size());
-
-    boost::filesystem::path dialoguesPath = basedir / "data/dialogues.yml";
-    loadDialogData(m_dialogues, dialoguesPath.string());
-    game::Log::info(game::Log::RESOURCES, "\tDialog data: %zu\n", m_dialogues.size());
-
-    boost::filesystem::path messagesPath = basedir / "data/messages.yml";
-    loadMessageData(m_messages, messagesPath.string());
-    game::Log::info(game::Log::RESOURCES, "\tMessage data: %zu\n", m_messages.size());
-
-    boost::filesystem::path questsPath = basedir / "data/quests.yml";
-    loadQuestData(m_quests, questsPath.string());
-    game::Log::info(game::Log::RESOURCES, "\tQuest data: %zu\n", m_quests.size());
+    return m_dialogCache.insert(id, std::move(dialog));
   }
 
-  namespace {
-
-    struct DataConstructor : public tmx::LayerVisitor {
-      DataConstructor(DataManager& manager)
-      : m_manager(manager)
-      {
-
-      }
-
-      virtual void visitObjectLayer(const tmx::Map& map, const tmx::ObjectLayer& layer) override {
-        if (!layer.hasProperty("kind")) {
-          game::Log::warning(game::Log::GRAPHICS, "No kind for the layer: '%s'\n", layer.getName().c_str());
-          return;
-        }
-
-        if (layer.getProperty("kind", "") != "poi") {
-          return;
-        }
-
-        int floor = std::stoi(layer.getProperty("floor", "0"));
-
-        game::Log::info(game::Log::RESOURCES, "Loading POI layer: '%s' (floor: %i)\n", layer.getName().c_str(), floor);
-
-        unsigned count = 0;
-
-        for (auto obj : layer) {
-          const std::string& name = obj->getName();
+  const DialogData *DataManager::getDialogDataFor(const std::string& name) const {
+    return getDialog(game::Hash(name), name.c_str());
+  }
 
-          if (!obj->isEllipse()) {
-            game::Log::warning(game::Log::RESOURCES, "Object is not an ellipse: '%s'\n", name.c_str());
-            continue;
-          }
+  const DialogData *DataManager::getDialogDataFor(game::Id id) const {
+    return getDialog(id, nullptr);
+  }
 
-          sf::Vector2f pos(obj->getX(), obj->getY());
-          m_manager.addPointOfInterestData(name, { pos, floor });
+  const MessageData *DataManager::getMessage(game::Id id, const char *name) const {
+    if (!m_database) {
+      return findData(m_messages, id, "message", name);
+    }
 
-          count++;
-        }
+    auto it = m_messageCache.find(id);
 
-        game::Log::info(game::Log::RESOURCES, "\tPOI loaded: %u\n", count);
-      }
+    if (it != m_messageCache.end()) {
+      return &it->second;
+    }
 
-    private:
-      DataManager& m_manager;
-    };
+    auto record = findData(m_database->getMessages(), id, "message", name);
 
+    if (record == nullptr) {
+      return nullptr;
+    }
 
+    MessageData data;
+    data.message = convertString(m_database->getText(record->message));
+    return &m_messageCache.insert(std::make_pair(id, std::move(data))).first->second;
   }
 
-  void DataManager::loadMap(const tmx::Map& map) {
-    DataConstructor visitor(*this);
-    map.visitLayers(visitor);
+  const MessageData *DataManager::getMessageDataFor(const std::string& name) const {
+    return getMessage(game::Hash(name), name.c_str());
   }
 
-  const CollisionData *DataManager::getCollisionDataFor(const std::string& name) const {
-    auto it = m_collisions.find(name);
+  const MessageData *DataManager::getMessageDataFor(game::Id id) const {
+    return getMessage(id, nullptr);
+  }
 
-    if (it == m_collisions.end()) {
-      game::Log::warning(game::Log::RESOURCES, "Could not find collision data for '%s'\n", name.c_str());
-      return nullptr;
+  const QuestData *DataManager::getQuest(game::Id id, const char *name) const {
+    if (!m_database) {
+      auto entry = findData(m_quests, id, "quest", name);
+      return entry != nullptr ? &entry->data : nullptr;
     }
 
-    return &it->second;
-  }
+    auto it = m_questCache.find(id);
 
-  const SpriteData *DataManager::getSpriteDataFor(const std::string& name) const {
-    auto it = m_sprites.find(name);
+    if (it != m_questCache.end()) {
+      return &it->second;
+    }
+
+    auto record = findData(m_database->getQuests(), id, "quest", name);
 
-    if (it == m_sprites.end()) {
-      game::Log::warning(game::Log::RESOURCES, "Could not find sprite data for '%s'\n", name.c_str());
+    if (record == nullptr) {
       return nullptr;
     }
 
-    return &it->second;
+    return &m_questCache.insert(std::make_pair(id, convertQuestRecord(*m_database, *record))).first->second;
   }
 
-  std::tuple<const CollisionData *, const SpriteData *> DataManager::getItemDataFor(const std::string& name) const {
-    auto it = m_items.find(name);
-
-    if (it == m_items.end()) {
-      game::Log::warning(game::Log::RESOURCES, "Could not find item data for '%s'\n", name.c_str());
-      return std::make_tuple(nullptr, nullptr);
-    }
-
-    ItemData data = it->second;
-    return std::make_tuple(getCollisionDataFor(data.collision), getSpriteDataFor(data.sprite));
+  const QuestData *DataManager::getQuestDataFor(const std::string& name) const {
+    return getQuest(game::Hash(name), name.c_str());
   }
 
-  void DataManager::addPointOfInterestData(std::string name, const Location& loc) {
-    m_pois.insert(std::make_pair(std::move(name), PointOfInterestData{ loc }));
+  const QuestData *DataManager::getQuestDataFor(game::Id id) const {
+    return getQuest(id, nullptr);
   }
 
-  const PointOfInterestData *DataManager::getPointOfInterestDataFor(const std::string& name) const {
-    auto it = m_pois.find(name);
+  const QuestTextData *DataManager::getQuestText(game::Id id, const char *name) const {
+    const QuestTextData *data = m_questTextCache.find(id);
 
-    if (it == m_pois.end()) {
-      game::Log::warning(game::Log::RESOURCES, "Could not find point of interest data for '%s'\n", name.c_str());
-      return nullptr;
+    if (data != nullptr) {
+      return data;
     }
 
-    return &it->second;
-  }
+    QuestTextData text;
 
-  const DialogData *DataManager::getDialogDataFor(const std::string& name) const {
-    auto it = m_dialogues.find(name);
+    if (m_database) {
+      // the texts of the data base are already translated
+      auto record = findData(m_database->getQuests(), id, "quest", name);
 
-    if (it == m_dialogues.end()) {
-      game::Log::warning(game::Log::RESOURCES, "Could not find dialogue data for '%s'\n", name.c_str());
-      return nullptr;
-    }
+      if (record == nullptr) {
+        return nullptr;
+      }
 
-    return &it->second;
-  }
+      text.title = convertString(m_database->getText(record->title));
+      text.goal = convertString(m_database->getText(record->goal));
+      text.description = convertString(m_database->getText(record->description));
+    } else {
+      auto entry = findData(m_quests, id, "quest", name);
 
-  const MessageData *DataManager::getMessageDataFor(const std::string& name) const {
-    auto it = m_messages.find(name);
+      if (entry == nullptr) {
+        return nullptr;
+      }
 
-    if (it == m_messages.end()) {
-      game::Log::warning(game::Log::RESOURCES, "Could not find message data for '%s'\n", name.c_str());
-      return nullptr;
+      text.title = getText(entry->title, true);
+      text.goal = getText(entry->goal, true);
+      text.description = getText(entry->description, true);
     }
 
-    return &it->second;
+    return m_questTextCache.insert(id, std::move(text));
   }
 
-  const QuestData *DataManager::getQuestDataFor(const std::string& name) const {
-    auto it = m_quests.find(name);
-
-    if (it == m_quests.end()) {
-      game::Log::warning(game::Log::RESOURCES, "Could not find quest data for '%s'\n", name.c_str());
-      return nullptr;
-    }
+  const QuestTextData *DataManager::getQuestTextFor(const std::string& name) const {
+    return getQuestText(game::Hash(name), name.c_str());
+  }
 
-    return &it->second;
+  const QuestTextData *DataManager::getQuestTextFor(game::Id id) const {
+    return getQuestText(id, nullptr);
   }
 
 }
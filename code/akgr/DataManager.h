@@ -20,45 +20,262 @@
 #ifndef AKGR_DATA_MANAGER_H
 #define AKGR_DATA_MANAGER_H
 
+#include <algorithm>
+#include <cassert>
+#include <list>
 #include <map>
+#include <memory>
 #include <string>
+#include <tuple>
+#include <vector>
 
 #include <boost/filesystem.hpp>
 
-#include <tmx/Map.h>
+#include <game/Id.h>
 
 #include "Data.h"
+#include "DataParser.h"
+#include "MapLoader.h"
 
 namespace akgr {
 
-  class DataManager {
+  class DataBase;
+
+  /*
+   * A flat table sorted by id. The data is appended and the table is sorted
+   * once all the data has been added, the first data added for an id is kept.
+   */
+  template<typename T>
+  class DataTable {
+  public:
+    struct Entry {
+      game::Id id;
+      T data;
+    };
+
+    void add(game::Id id, T data) {
+      m_entries.push_back(Entry{ id, std::move(data) });
+    }
+
+    /*
+     * Sort the table after the last add, return the number of duplicate ids
+     * that were removed
+     */
+    std::size_t sort() {
+      std::stable_sort(m_entries.begin(), m_entries.end(), [](const Entry& lhs, const Entry& rhs) {
+        return lhs.id < rhs.id;
+      });
+
+      auto last = std::unique(m_entries.begin(), m_entries.end(), [](const Entry& lhs, const Entry& rhs) {
+        return lhs.id == rhs.id;
+      });
+
+      std::size_t duplicates = m_entries.end() - last;
+      m_entries.erase(last, m_entries.end());
+      return duplicates;
+    }
+
+    const T *find(game::Id id) const {
+      auto it = std::lower_bound(m_entries.begin(), m_entries.end(), id, [](const Entry& entry, game::Id id) {
+        return entry.id < id;
+      });
+
+      if (it == m_entries.end() || it->id != id) {
+        return nullptr;
+      }
+
+      return &it->data;
+    }
+
+    std::size_t size() const {
+      return m_entries.size();
+    }
+
+    typename std::vector<Entry>::iterator begin() {
+      return m_entries.begin();
+    }
+
+    typename std::vector<Entry>::iterator end() {
+      return m_entries.end();
+    }
+
+  private:
+    std::vector<Entry> m_entries;
+  };
+
+  /*
+   * A small cache of the most recently used data, the least recently used is evicted
+   */
+  template<typename T>
+  class DataCache {
+  public:
+    DataCache(std::size_t capacity)
+    : m_capacity(capacity)
+    {
+      assert(capacity > 0);
+    }
+
+    const T *find(game::Id id) {
+      for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+        if (it->first == id) {
+          m_entries.splice(m_entries.begin(), m_entries, it);
+          return &m_entries.front().second;
+        }
+      }
+
+      return nullptr;
+    }
+
+    const T *insert(game::Id id, T data) {
+      if (m_entries.size() == m_capacity) {
+        m_entries.pop_back();
+      }
+
+      m_entries.emplace_front(id, std::move(data));
+      return &m_entries.front().second;
+    }
+
+    void clear() {
+      m_entries.clear();
+    }
+
+  private:
+    std::size_t m_capacity;
+    std::list<std::pair<game::Id, T>> m_entries;
+  };
+
+  /*
+   * The data of the game, served from the compiled data base when it is up
+   * to date, or from the YAML data files otherwise.
+   *
+   * The data base stays mapped: the collisions and the items are read in
+   * place, and the records that need a conversion (sprites, messages,
+   * quests, dialogues) are converted when they are first requested.
+   */
+  class DataManager : public MapSink, private DataSink {
   public:
-    void load(const boost::filesystem::path& basedir);
-    void loadMap(const tmx::Map& map);
+    DataManager();
+    ~DataManager();
+
+    /*
+     * Load the compiled data base if it is up to date, first the installed
+     * one and then the one of the build tree, or the YAML data files
+     */
+    void load(const boost::filesystem::path& basedir, const boost::filesystem::path& localedir, const boost::filesystem::path& buildDatabasePath);
+    virtual void loadLayer(const MapCache& cache, const MapCache::Layer& layer) override;
 
     const CollisionData *getCollisionDataFor(const std::string& name) const;
+    const CollisionData *getCollisionDataFor(game::Id id) const;
+
+    /*
+     * Same as getCollisionDataFor but without a warning when there is no
+     * data, for sprites that may have no collision
+     */
+    const CollisionData *findCollisionDataFor(game::Id id) const;
 
     const SpriteData *getSpriteDataFor(const std::string& name) const;
+    const SpriteData *getSpriteDataFor(game::Id id) const;
 
     std::tuple<const CollisionData *, const SpriteData *> getItemDataFor(const std::string& name) const;
+    std::tuple<const CollisionData *, const SpriteData *> getItemDataFor(game::Id id) const;
 
-    void addPointOfInterestData(std::string name, const Location& loc);
     const PointOfInterestData *getPointOfInterestDataFor(const std::string& name) const;
+    const PointOfInterestData *getPointOfInterestDataFor(game::Id id) const;
 
+    /*
+     * The dialogue is translated on first use and kept in a small cache of the
+     * last requested dialogues, the data remains valid until it is evicted
+     * from the cache, i.e. after 8 other dialogues have been requested
+     */
     const DialogData *getDialogDataFor(const std::string& name) const;
+    const DialogData *getDialogDataFor(game::Id id) const;
 
     const MessageData *getMessageDataFor(const std::string& name) const;
+    const MessageData *getMessageDataFor(game::Id id) const;
 
     const QuestData *getQuestDataFor(const std::string& name) const;
+    const QuestData *getQuestDataFor(game::Id id) const;
+
+    /*
+     * The texts are translated on first use and kept in a small cache of the
+     * last requested quests, the data remains valid until it is evicted from
+     * the cache, i.e. after 16 other quest texts have been requested
+     */
+    const QuestTextData *getQuestTextFor(const std::string& name) const;
+    const QuestTextData *getQuestTextFor(game::Id id) const;
+
+  private:
+    void sortTables();
+    void resolveItems();
+
+    const CollisionData *getCollision(game::Id id, const char *name) const;
+    const SpriteData *getSprite(game::Id id, const char *name) const;
+    std::tuple<const CollisionData *, const SpriteData *> getItem(game::Id id, const char *name) const;
+    const MessageData *getMessage(game::Id id, const char *name) const;
+    const QuestData *getQuest(game::Id id, const char *name) const;
+    const QuestTextData *getQuestText(game::Id id, const char *name) const;
+
+    uint32_t addText(const std::string& text);
+    sf::String getText(uint32_t offset, bool translate) const;
+
+    const DialogData *getDialog(game::Id id, const char *name) const;
+
+    virtual void addCollisionData(std::string name, const CollisionData& data) override;
+    virtual void addSpriteData(std::string name, SpriteData data) override;
+    virtual void addItemData(std::string name, ItemData data) override;
+    virtual void addDialogData(std::string name, const std::vector<DialogLineText>& content) override;
+    virtual void addMessageData(std::string name, const std::string& message) override;
+    virtual void addQuestData(std::string name, const QuestData& data, const QuestText& text) override;
 
   private:
-    std::map<std::string, CollisionData> m_collisions;
-    std::map<std::string, SpriteData> m_sprites;
-    std::map<std::string, ItemData> m_items;
-    std::map<std::string, PointOfInterestData> m_pois;
-    std::map<std::string, DialogData> m_dialogues;
-    std::map<std::string, MessageData> m_messages;
-    std::map<std::string, QuestData> m_quests;
+    struct ItemEntry {
+      game::Id sprite;
+      game::Id collision;
+      const SpriteData *spriteData;
+      const CollisionData *collisionData;
+    };
+
+    struct DialogEntry {
+      uint32_t firstLine;
+      uint32_t lineCount;
+    };
+
+    struct LineEntry {
+      uint32_t speaker;
+      uint32_t words;
+    };
+
+    struct QuestEntry {
+      QuestData data;
+      uint32_t title;
+      uint32_t goal;
+      uint32_t description;
+    };
+
+    // the compiled data, or null if the data files are used
+    std::unique_ptr<DataBase> m_database;
+
+    // the converted records of the data base, kept for the whole game
+    mutable std::map<game::Id, SpriteData> m_spriteCache;
+    mutable std::map<game::Id, MessageData> m_messageCache;
+    mutable std::map<game::Id, QuestData> m_questCache;
+
+    // the data of the data files
+    DataTable<CollisionData> m_collisions;
+    DataTable<SpriteData> m_sprites;
+    DataTable<ItemEntry> m_items;
+    DataTable<DialogEntry> m_dialogues;
+    DataTable<MessageData> m_messages;
+    DataTable<QuestEntry> m_quests;
+
+    // UTF-8 texts of the dialogues and quests of the data files, not translated yet
+    std::string m_texts;
+    std::vector<LineEntry> m_lines;
+
+    DataTable<PointOfInterestData> m_pois;
+
+    mutable DataCache<DialogData> m_dialogCache;
+    mutable DataCache<QuestTextData> m_questTextCache;
   };
 
 
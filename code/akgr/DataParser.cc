@@ -0,0 +1,453 @@
+/*
+ * Akagoria, the revenge of Kalista
+ * a single-player RPG in an open world with a top-down view.
+ *
+ * Copyright (c) 2013-2015, Julien Bernard
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "DataParser.h"
+
+#include <cassert>
+
+#include <yaml-cpp/yaml.h>
+
+#include <game/Log.h>
+
+namespace akgr {
+
+  DataSink::~DataSink() {
+  }
+
+  static void loadCollisionData(DataSink& sink, const std::string& path) {
+    try {
+      YAML::Node node = YAML::LoadFile(path);
+
+      assert(node.IsMap());
+
+      for (const auto& entry : node) {
+        std::string name = entry.first.as<std::string>();
+        auto properties = entry.second;
+
+        assert(properties.IsMap());
+
+        auto typeNode = properties["type"];
+
+        if (!typeNode) {
+          game::Log::warning(game::Log::RESOURCES, "Missing type for entry: '%s'\n", name.c_str());
+          continue;
+        }
+
+        std::string type = typeNode.as<std::string>();
+
+        CollisionData data;
+
+        if (type == "circle") {
+          data.shape = CollisionShape::CIRCLE;
+
+          auto radiusNode = properties["radius"];
+          assert(radiusNode);
+
+          data.circle.radius = radiusNode.as<float>();
+
+        } else {
+          game::Log::warning(game::Log::RESOURCES, "Unknown type for entry: '%s'\n", name.c_str());
+          continue;
+        }
+
+        sink.addCollisionData(std::move(name), data);
+      }
+    } catch (std::exception& ex) {
+      game::Log::error(game::Log::RESOURCES, "Error when loading collision database: %s\n", ex.what());
+      return;
+    }
+  }
+
+  static void loadSpriteData(DataSink& sink, const std::string& path) {
+    try {
+      YAML::Node node = YAML::LoadFile(path);
+
+      assert(node.IsMap());
+
+      for (const auto& entry : node) {
+        std::string name = entry.first.as<std::string>();
+        auto properties = entry.second;
+
+        assert(properties.IsMap());
+
+        auto imageNode = properties["image"];
+
+        if (!imageNode) {
+          game::Log::warning(game::Log::RESOURCES, "Missing image for entry: '%s'\n", name.c_str());
+          continue;
+        }
+
+        std::string image = imageNode.as<std::string>();
+
+        auto dimensionNode = properties["dimension"];
+
+        if (!dimensionNode) {
+          game::Log::warning(game::Log::RESOURCES, "Missing dimension for entry: '%s'\n", name.c_str());
+          continue;
+        }
+
+        assert(dimensionNode.IsMap());
+
+        int width = dimensionNode["width"].as<int>();
+        assert(width > 0);
+        int height = dimensionNode["height"].as<int>();
+        assert(height > 0);
+
+        auto spriteNode = properties["sprite"];
+
+        if (!spriteNode) {
+          game::Log::warning(game::Log::RESOURCES, "Missing sprite for entry: '%s'\n", name.c_str());
+          continue;
+        }
+
+        assert(spriteNode.IsMap());
+
+        int spriteWidth = spriteNode["width"].as<int>();
+        assert(spriteWidth > 0);
+        int spriteHeight = spriteNode["height"].as<int>();
+        assert(spriteHeight > 0);
+
+        assert(width % spriteWidth == 0);
+        assert(height % spriteHeight == 0);
+
+        int count = width / spriteWidth;
+        assert(count > 0);
+
+        auto ids_node = properties["ids"];
+
+        unsigned k = 0;
+
+        for (auto id : ids_node) {
+          std::string name = id.as<std::string>();
+
+          int left = (k % count) * spriteWidth;
+          int top = (k / count) * spriteHeight;
+
+          SpriteData data;
+          data.image = image;
+          data.rectangle = { left, top, spriteWidth, spriteHeight };
+
+          sink.addSpriteData(std::move(name), std::move(data));
+
+        }
+      }
+    } catch (std::exception& ex) {
+      game::Log::error(game::Log::RESOURCES, "Error when loading sprite database: %s\n", ex.what());
+      return;
+    }
+  }
+
+  static void loadItemData(DataSink& sink, const std::string& path) {
+    try {
+      YAML::Node node = YAML::LoadFile(path);
+
+      assert(node.IsMap());
+
+      for (const auto& entry : node) {
+        std::string name = entry.first.as<std::string>();
+        auto properties = entry.second;
+
+        ItemData data;
+
+        assert(properties.IsMap());
+
+        auto spriteNode = properties["sprite"];
+
+        if (!spriteNode) {
+          game::Log::warning(game::Log::RESOURCES, "Missing sprite for entry: '%s'\n", name.c_str());
+          continue;
+        }
+
+        data.sprite = spriteNode.as<std::string>();
+
+        auto collisionNode = properties["collision"];
+
+        if (!collisionNode) {
+          game::Log::warning(game::Log::RESOURCES, "Missing collision for entry: '%s'\n", name.c_str());
+          continue;
+        }
+
+        data.collision = collisionNode.as<std::string>();
+
+        sink.addItemData(std::move(name), std::move(data));
+      }
+    } catch (std::exception& ex) {
+      game::Log::error(game::Log::RESOURCES, "Error when loading item database: %s\n", ex.what());
+      return;
+    }
+  }
+
+  static void loadDialogData(DataSink& sink, const std::string& path) {
+    try {
+      YAML::Node node = YAML::LoadFile(path);
+
+      assert(node.IsMap());
+
+      for (const auto& entry : node) {
+        std::string name = entry.first.as<std::string>();
+        auto properties = entry.second;
+
+        std::vector<DialogLineText> content;
+
+        assert(properties.IsMap());
+
+        auto contentNode = properties["content"];
+
+        if (!contentNode) {
+          game::Log::warning(game::Log::RESOURCES, "Missing content for entry: '%s'\n", name.c_str());
+          continue;
+        }
+
+        assert(contentNode.IsSequence());
+
+        for (const auto& lineNode : contentNode) {
+          auto speakerNode = lineNode["speaker"];
+          assert(speakerNode);
+          auto speaker = speakerNode.as<std::string>();
+
+          auto wordsNode = lineNode["words"];
+          assert(wordsNode);
+          auto words = wordsNode.as<std::string>();
+
+          content.push_back({ std::move(speaker), std::move(words) });
+        }
+
+        sink.addDialogData(std::move(name), content);
+      }
+    } catch (std::exception& ex) {
+      game::Log::error(game::Log::RESOURCES, "Error when loading dialog database: %s\n", ex.what());
+      return;
+    }
+  }
+
+  static void loadMessageData(DataSink& sink, const std::string& path) {
+    try {
+      YAML::Node node = YAML::LoadFile(path);
+
+      assert(node.IsMap());
+
+      for (const auto& entry : node) {
+        std::string name = entry.first.as<std::string>();
+        auto properties = entry.second;
+
+        assert(properties.IsMap());
+
+        auto messageNode = properties["message"];
+
+        if (!messageNode) {
+          game::Log::warning(game::Log::RESOURCES, "Missing message for entry: '%s'\n", name.c_str());
+          continue;
+        }
+
+        sink.addMessageData(std::move(name), messageNode.as<std::string>());
+      }
+    } catch (std::exception& ex) {
+      game::Log::error(game::Log::RESOURCES, "Error when loading message database: %s\n", ex.what());
+      return;
+    }
+  }
+
+  static void loadQuestData(DataSink& sink, const std::string& path) {
+    try {
+      YAML::Node node = YAML::LoadFile(path);
+
+      assert(node.IsMap());
+
+      for (const auto& entry : node) {
+        std::string name = entry.first.as<std::string>();
+        auto properties = entry.second;
+
+        QuestData data;
+        QuestText text;
+
+        assert(properties.IsMap());
+
+        auto titleNode = properties["title"];
+
+        if (!titleNode) {
+          game::Log::warning(game::Log::RESOURCES, "Missing title for entry: '%s'\n", name.c_str());
+          continue;
+        }
+
+        text.title = titleNode.as<std::string>();
+
+        auto goalNode = properties["goal"];
+
+        if (!goalNode) {
+          game::Log::warning(game::Log::RESOURCES, "Missing goal for entry: '%s'\n", name.c_str());
+          continue;
+        }
+
+        text.goal = goalNode.as<std::string>();
+
+        auto descriptionNode = properties["description"];
+
+        if (!descriptionNode) {
+          game::Log::warning(game::Log::RESOURCES, "Missing description for entry: '%s'\n", name.c_str());
+          continue;
+        }
+
+        text.description = descriptionNode.as<std::string>();
+
+        auto categoryNode = properties["category"];
+
+        if (!categoryNode) {
+          game::Log::warning(game::Log::RESOURCES, "Missing category for entry: '%s'\n", name.c_str());
+          continue;
+        }
+
+        std::string category = categoryNode.as<std::string>();
+
+        if (category == "history") {
+          data.category = QuestCategory::HISTORY;
+        } else if (category == "short") {
+          data.category = QuestCategory::SHORT;
+        } else if (category == "medium") {
+          data.category = QuestCategory::MEDIUM;
+        } else if (category == "long") {
+          data.category = QuestCategory::LONG;
+        } else {
+          game::Log::warning(game::Log::RESOURCES, "Unknown category for entry: '%s'\n", name.c_str());
+          continue;
+        }
+
+        auto parametersNode = properties["parameters"];
+
+        if (!parametersNode) {
+          game::Log::warning(game::Log::RESOURCES, "Missing parameters for entry: '%s'\n", name.c_str());
+          continue;
+        }
+
+        assert(parametersNode.IsMap());
+
+        auto typeNode = properties["type"];
+
+        if (!typeNode) {
+          game::Log::warning(game::Log::RESOURCES, "Missing type for entry: '%s'\n", name.c_str());
+          continue;
+        }
+
+        std::string type = typeNode.as<std::string>();
+
+        if (type == "explore") {
+          data.type = QuestType::EXPLORE;
+
+          auto placeNode = parametersNode["place"];
+
+          if (!placeNode) {
+            game::Log::warning(game::Log::RESOURCES, "Missing place for entry: '%s'\n", name.c_str());
+            continue;
+          }
+
+          data.explore.place = game::Hash(placeNode.as<std::string>());
+
+        } else if (type == "farm") {
+          data.type = QuestType::FARM;
+
+          auto itemNode = parametersNode["item"];
+
+          if (!itemNode) {
+            game::Log::warning(game::Log::RESOURCES, "Missing item for entry: '%s'\n", name.c_str());
+            continue;
+          }
+
+          data.farm.item = game::Hash(itemNode.as<std::string>());
+
+          auto countNode = parametersNode["count"];
+
+          if (!countNode) {
+            game::Log::warning(game::Log::RESOURCES, "Missing count for entry: '%s'\n", name.c_str());
+            continue;
+          }
+
+          data.farm.count = countNode.as<unsigned>();
+
+        } else if (type == "hunt") {
+          data.type = QuestType::HUNT;
+
+          auto monsterNode = parametersNode["monster"];
+
+          if (!monsterNode) {
+            game::Log::warning(game::Log::RESOURCES, "Missing monster for entry: '%s'\n", name.c_str());
+            continue;
+          }
+
+          data.hunt.monster = game::Hash(monsterNode.as<std::string>());
+
+          auto countNode = parametersNode["count"];
+
+          if (!countNode) {
+            game::Log::warning(game::Log::RESOURCES, "Missing count for entry: '%s'\n", name.c_str());
+            continue;
+          }
+
+          data.hunt.count = countNode.as<unsigned>();
+
+        } else if (type == "talk") {
+          data.type = QuestType::TALK;
+
+          auto conversationNode = parametersNode["conversation"];
+
+          if (!conversationNode) {
+            game::Log::warning(game::Log::RESOURCES, "Missing conversation for entry: '%s'\n", name.c_str());
+            continue;
+          }
+
+          data.talk.conversation = game::Hash(conversationNode.as<std::string>());
+
+        } else {
+          game::Log::warning(game::Log::RESOURCES, "Unknown type for entry: '%s'\n", name.c_str());
+          continue;
+        }
+
+        auto nextNode = properties["next"];
+
+        if (nextNode) {
+          data.next = nextNode.as<std::string>();
+        }
+
+        sink.addQuestData(std::move(name), data, text);
+      }
+    } catch (std::exception& ex) {
+      game::Log::error(game::Log::RESOURCES, "Error when loading quest database: %s\n", ex.what());
+      return;
+    }
+  }
+
+  void parseDataFiles(const boost::filesystem::path& basedir, DataSink& sink) {
+    boost::filesystem::path collisionsPath = basedir / "data/collisions.yml";
+    loadCollisionData(sink, collisionsPath.string());
+
+    boost::filesystem::path spritesPath = basedir / "data/sprites.yml";
+    loadSpriteData(sink, spritesPath.string());
+
+    boost::filesystem::path itemsPath = basedir / "data/items.yml";
+    loadItemData(sink, itemsPath.string());
+
+    boost::filesystem::path dialoguesPath = basedir / "data/dialogues.yml";
+    loadDialogData(sink, dialoguesPath.string());
+
+    boost::filesystem::path messagesPath = basedir / "data/messages.yml";
+    loadMessageData(sink, messagesPath.string());
+
+    boost::filesystem::path questsPath = basedir / "data/quests.yml";
+    loadQuestData(sink, questsPath.string());
+  }
+
+}
@@ -0,0 +1,66 @@
+/*
+ * Akagoria, the revenge of Kalista
+ * a single-player RPG in an open world with a top-down view.
+ *
+ * Copyright (c) 2013-2015, Julien Bernard
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef AKGR_DATA_PARSER_H
+#define AKGR_DATA_PARSER_H
+
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "Data.h"
+
+namespace akgr {
+
+  /*
+   * The texts are given as they are in the data files, in UTF-8 and not
+   * translated yet.
+   */
+  struct DialogLineText {
+    std::string speaker;
+    std::string words;
+  };
+
+  struct QuestText {
+    std::string title;
+    std::string goal;
+    std::string description;
+  };
+
+  class DataSink {
+  public:
+    virtual ~DataSink();
+
+    virtual void addCollisionData(std::string name, const CollisionData& data) = 0;
+    virtual void addSpriteData(std::string name, SpriteData data) = 0;
+    virtual void addItemData(std::string name, ItemData data) = 0;
+    virtual void addDialogData(std::string name, const std::vector<DialogLineText>& content) = 0;
+    virtual void addMessageData(std::string name, const std::string& message) = 0;
+    virtual void addQuestData(std::string name, const QuestData& data, const QuestText& text) = 0;
+  };
+
+  /*
+   * Parse the YAML data files in basedir/data.
+   */
+  void parseDataFiles(const boost::filesystem::path& basedir, DataSink& sink);
+
+}
+
+#endif // AKGR_DATA_PARSER_H
@@ -84,12 +84,12 @@ namespace akgr {
     return m_currentDialog != nullptr;
   }
 
-  void DialogManager::render(sf::RenderWindow& window) {
+  void DialogManager::render(game::RenderQueue& queue) {
     if (m_currentDialog == nullptr) {
       return;
     }
 
-    m_ui.render(window);
+    m_ui.render(queue);
   }
 
 }
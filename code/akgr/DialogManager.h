@@ -38,7 +38,7 @@ namespace akgr {
 
     bool hasNextLine() const;
 
-    virtual void render(sf::RenderWindow& window) override;
+    virtual void render(game::RenderQueue& queue) override;
 
   private:
     DialogUI m_ui;
@@ -106,8 +106,8 @@ namespace akgr {
     m_currentUI->update(dt);
   }
 
-  void GameDriver::render(sf::RenderWindow& window) {
-    m_currentUI->render(window);
+  void GameDriver::render(game::RenderQueue& queue) {
+    m_currentUI->render(queue);
   }
 
   void GameDriver::setArrowActionsContinuous() {
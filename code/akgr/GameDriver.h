@@ -37,7 +37,7 @@ namespace akgr {
     void onUse();
 
     void update(float dt);
-    void render(sf::RenderWindow& window);
+    void render(game::RenderQueue& queue);
 
   private:
     void setArrowActionsContinuous();
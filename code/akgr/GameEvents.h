@@ -32,6 +32,8 @@ namespace akgr {
     static const game::EventType type = "HeroLocationEvent"_type;
 
     Location loc;
+    sf::Vector2f velocity;
+    float dt; // the duration of the frame
   };
 
   struct DialogEndEvent : public game::Event {
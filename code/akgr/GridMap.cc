@@ -19,15 +19,151 @@
  */
 #include "GridMap.h"
 
+#include <algorithm>
+
+#include <game/Log.h>
+
 #include "GameEvents.h"
 #include "MapEvents.h"
 #include "Singletons.h"
 
 namespace akgr {
 
+  // the cells are prepared a few frames before the hero can see them
+  static constexpr float PREFETCH_FRAMES = 2.0f;
+
+  CellVertices::CellVertices()
+  : m_vertexCount(0)
+  , m_margin(0.0f)
+  {
+  }
+
+  void CellVertices::addQuad(const sf::Vertex *quad, float subUnit) {
+    sf::Vector2f min = quad[0].position;
+    sf::Vector2f max = quad[0].position;
+
+    for (std::size_t i = 1; i < 4; ++i) {
+      min.x = std::min(min.x, quad[i].position.x);
+      min.y = std::min(min.y, quad[i].position.y);
+      max.x = std::max(max.x, quad[i].position.x);
+      max.y = std::max(max.y, quad[i].position.y);
+    }
+
+    sf::Vector2f center = (min + max) / 2.0f;
+    m_margin = std::max(m_margin, std::max(max.x - center.x, max.y - center.y));
+
+    unsigned x = static_cast<unsigned>(std::max(center.x, 0.0f) / subUnit) % SUBDIVISION;
+    unsigned y = static_cast<unsigned>(std::max(center.y, 0.0f) / subUnit) % SUBDIVISION;
+    m_subCells.push_back(y * SUBDIVISION + x);
+
+    m_vertices.insert(m_vertices.end(), quad, quad + 4);
+  }
+
+  void CellVertices::finish() {
+    static constexpr unsigned SUB_CELL_COUNT = SUBDIVISION * SUBDIVISION;
+
+    assert(m_subCells.size() * 4 == m_vertices.size());
+
+    // counting sort of the quads
+    m_offsets.assign(SUB_CELL_COUNT + 1, 0);
+
+    for (auto subCell : m_subCells) {
+      m_offsets[subCell + 1] += 4;
+    }
+
+    for (unsigned i = 0; i < SUB_CELL_COUNT; ++i) {
+      m_offsets[i + 1] += m_offsets[i];
+    }
+
+    std::vector<std::size_t> next(m_offsets.begin(), m_offsets.end() - 1);
+    std::vector<sf::Vertex> vertices(m_vertices.size());
+
+    for (std::size_t i = 0; i < m_subCells.size(); ++i) {
+      std::size_t& offset = next[m_subCells[i]];
+      std::copy_n(m_vertices.begin() + i * 4, 4, vertices.begin() + offset);
+      offset += 4;
+    }
+
+    m_vertices.swap(vertices);
+    m_vertexCount = m_vertices.size();
+    std::vector<unsigned>().swap(m_subCells);
+  }
+
+  void CellVertices::upload() {
+    if (m_vertexCount == 0 || m_buffer || !sf::VertexBuffer::isAvailable()) {
+      return;
+    }
+
+    auto buffer = std::make_shared<sf::VertexBuffer>(sf::Quads, sf::VertexBuffer::Static);
+
+    if (!buffer->create(m_vertexCount) || !buffer->update(m_vertices.data())) {
+      game::Log::warning(game::Log::GRAPHICS, "Could not upload a cell to the GPU, keeping the vertices in memory\n");
+      return;
+    }
+
+    m_buffer = std::move(buffer);
+    std::vector<sf::Vertex>().swap(m_vertices);
+  }
+
+  void CellVertices::drawRange(game::RenderQueue& queue, int priority, const sf::Texture *texture, std::size_t first, std::size_t count) const {
+    if (m_buffer) {
+      queue.addBuffer(priority, texture, m_buffer, first, count);
+    } else {
+      queue.addQuads(priority, texture, &m_vertices[first], count);
+    }
+  }
+
+  static unsigned clampSubCell(float coord, float subUnit) {
+    if (coord < 0.0f) {
+      return 0;
+    }
+
+    return std::min(static_cast<unsigned>(coord / subUnit), CellVertices::SUBDIVISION - 1);
+  }
+
+  void CellVertices::draw(game::RenderQueue& queue, int priority, const sf::Texture *texture, const CellClip& clip) const {
+    if (m_vertexCount == 0) {
+      return;
+    }
+
+    if (clip.whole) {
+      drawRange(queue, priority, texture, 0, m_vertexCount);
+      return;
+    }
+
+    assert(m_offsets.size() == SUBDIVISION * SUBDIVISION + 1);
+
+    // the view in the coordinates of the cell, extended by the margin
+    float left = clip.view.left - m_margin - clip.origin.x;
+    float top = clip.view.top - m_margin - clip.origin.y;
+    float right = clip.view.left + clip.view.width + m_margin - clip.origin.x;
+    float bottom = clip.view.top + clip.view.height + m_margin - clip.origin.y;
+
+    float size = clip.subUnit * SUBDIVISION;
+
+    if (right < 0.0f || bottom < 0.0f || left >= size || top >= size) {
+      return;
+    }
+
+    unsigned xmin = clampSubCell(left, clip.subUnit);
+    unsigned xmax = clampSubCell(right, clip.subUnit);
+    unsigned ymin = clampSubCell(top, clip.subUnit);
+    unsigned ymax = clampSubCell(bottom, clip.subUnit);
+
+    // the visible sub-cells of a row are contiguous
+    for (unsigned y = ymin; y <= ymax; ++y) {
+      std::size_t first = m_offsets[y * SUBDIVISION + xmin];
+      std::size_t last = m_offsets[y * SUBDIVISION + xmax + 1];
+
+      if (first < last) {
+        drawRange(queue, priority, texture, first, last - first);
+      }
+    }
+  }
+
   BaseMap::BaseMap(int priority)
     : game::Entity(priority)
-    , m_grid_width(0), m_grid_height(0), m_grid_unit(0), m_focus_x(0), m_focus_y(0), m_floor(0), m_dirty(true) {
+    , m_grid_width(0), m_grid_height(0), m_grid_unit(0), m_focus_x(0), m_focus_y(0), m_prefetch_x(0), m_prefetch_y(0), m_floor(0), m_dirty(true) {
     gEventManager().registerHandler<HeroLocationEvent>(&BaseMap::onHeroLocation, this);
   }
 
@@ -35,6 +171,7 @@ namespace akgr {
     m_grid_width = grid_width;
     m_grid_height = grid_height;
     m_grid_unit = grid_unit;
+    updateVisibleCells();
   }
 
   BaseMap::Range BaseMap::getXRange() const {
@@ -52,7 +189,8 @@ namespace akgr {
   game::EventStatus BaseMap::onHeroLocation(game::EventType type, game::Event *event) {
     assert(type == HeroLocationEvent::type);
 
-    Location loc = static_cast<HeroLocationEvent *>(event)->loc;
+    auto heroLocation = static_cast<HeroLocationEvent *>(event);
+    Location loc = heroLocation->loc;
 
     assert(loc.pos.x >= 0.0f);
     assert(loc.pos.y >= 0.0f);
@@ -63,6 +201,7 @@ namespace akgr {
     if (x != m_focus_x || y != m_focus_y) {
       m_focus_x = x;
       m_focus_y = y;
+      updateVisibleCells();
       setDirty();
     }
 
@@ -71,9 +210,105 @@ namespace akgr {
       setDirty();
     }
 
+    updatePrefetch(loc.pos + heroLocation->velocity * (PREFETCH_FRAMES * heroLocation->dt));
     return game::EventStatus::KEEP;
   }
 
+  void BaseMap::updateVisibleCells() {
+    if (m_grid_width == 0 || m_grid_height == 0) {
+      m_visible.clear();
+      return;
+    }
+
+    auto xrange = getXRange();
+    auto yrange = getYRange();
+
+    // drop the cells that left the window
+    m_visible.erase(std::remove_if(m_visible.begin(), m_visible.end(), [&](std::size_t index) {
+      unsigned x = index % m_grid_width;
+      unsigned y = index / m_grid_width;
+      return x < xrange.front() || x > xrange.back() || y < yrange.front() || y > yrange.back();
+    }), m_visible.end());
+
+    // add the cells that entered the window
+    for (auto y : yrange) {
+      for (auto x : xrange) {
+        std::size_t index = y * m_grid_width + x;
+
+        if (std::find(m_visible.begin(), m_visible.end(), index) == m_visible.end()) {
+          m_visible.push_back(index);
+        }
+      }
+    }
+  }
+
+  void BaseMap::prefetchCells(const std::vector<std::size_t>& cells) {
+  }
+
+  void BaseMap::updatePrefetch(sf::Vector2f pos) {
+    if (m_grid_width == 0 || m_grid_height == 0) {
+      return;
+    }
+
+    unsigned x = std::min(static_cast<unsigned>(std::max(pos.x, 0.0f) / m_grid_unit), m_grid_width - 1);
+    unsigned y = std::min(static_cast<unsigned>(std::max(pos.y, 0.0f) / m_grid_unit), m_grid_height - 1);
+
+    if (x == m_focus_x && y == m_focus_y) {
+      m_prefetch_x = x;
+      m_prefetch_y = y;
+      return;
+    }
+
+    if (x == m_prefetch_x && y == m_prefetch_y) {
+      return;
+    }
+
+    m_prefetch_x = x;
+    m_prefetch_y = y;
+
+    // the cells around the predicted focus that are not visible yet
+    unsigned xmin = (x > 0) ? x - 1 : x;
+    unsigned xmax = (x < m_grid_width - 1) ? x + 1 : x;
+    unsigned ymin = (y > 0) ? y - 1 : y;
+    unsigned ymax = (y < m_grid_height - 1) ? y + 1 : y;
+
+    std::vector<std::size_t> cells;
+
+    for (unsigned j = ymin; j <= ymax; ++j) {
+      for (unsigned i = xmin; i <= xmax; ++i) {
+        std::size_t index = j * m_grid_width + i;
+
+        if (std::find(m_visible.begin(), m_visible.end(), index) == m_visible.end()) {
+          cells.push_back(index);
+        }
+      }
+    }
+
+    prefetchCells(cells);
+  }
+
+  CellClip BaseMap::getCellClip(std::size_t index, const sf::FloatRect& view) const {
+    CellClip clip;
+    clip.view = view;
+    clip.subUnit = getSubUnit();
+
+    if (index >= static_cast<std::size_t>(m_grid_width) * m_grid_height) {
+      clip.origin = { 0.0f, 0.0f };
+      clip.whole = true;
+    } else {
+      clip.origin.x = static_cast<float>(index % m_grid_width * m_grid_unit);
+      clip.origin.y = static_cast<float>(index / m_grid_width * m_grid_unit);
+      clip.whole = false;
+    }
+
+    return clip;
+  }
+
+  sf::FloatRect BaseMap::getViewRect(const sf::View& view) {
+    // the bounds of the view in the world, even if the view is rotated
+    return view.getInverseTransform().transformRect(sf::FloatRect(-1.0f, -1.0f, 2.0f, 2.0f));
+  }
+
   unsigned BaseMap::computeGridSize(unsigned map_size, unsigned grid_unit) {
     if (map_size % grid_unit == 0) {
       return map_size / grid_unit;
@@ -21,17 +21,78 @@
 #define AKGR_GRID_MAP_H
 
 #include <cassert>
+#include <future>
+#include <map>
+#include <memory>
+#include <unordered_map>
 #include <vector>
 
 #include <boost/range/irange.hpp>
 
+#include <SFML/Graphics.hpp>
+
 #include <game/Entity.h>
 #include <game/Event.h>
+#include <game/RenderQueue.h>
 
 #include "Location.h"
+#include "Singletons.h"
 
 namespace akgr {
 
+  /*
+   * The view and the position of a cell, to draw only the part of the cell
+   * that is inside the view
+   */
+  struct CellClip {
+    sf::FloatRect view;
+    sf::Vector2f origin;
+    float subUnit;
+    bool whole;
+  };
+
+  /*
+   * The quads of a cell, sorted by sub-cell. A sub-cell is chosen with the
+   * center of the quad, and the margin is the largest half extent of the
+   * quads, so that a quad is drawn if its sub-cell is in the view extended
+   * by the margin.
+   *
+   * Once uploaded, the quads are kept in a static vertex buffer and the
+   * copy in memory is released.
+   */
+  class CellVertices {
+  public:
+    static constexpr unsigned SUBDIVISION = 5;
+
+    CellVertices();
+
+    void addQuad(const sf::Vertex *quad, float subUnit);
+
+    /*
+     * Sort the quads by sub-cell, to be called after the last quad
+     */
+    void finish();
+
+    /*
+     * Send the quads to the GPU, if vertex buffers are available. It must
+     * be called on the main thread, after finish().
+     */
+    void upload();
+
+    void draw(game::RenderQueue& queue, int priority, const sf::Texture *texture, const CellClip& clip) const;
+
+  private:
+    void drawRange(game::RenderQueue& queue, int priority, const sf::Texture *texture, std::size_t first, std::size_t count) const;
+
+  private:
+    std::vector<sf::Vertex> m_vertices;
+    std::shared_ptr<const sf::VertexBuffer> m_buffer;
+    std::size_t m_vertexCount;
+    std::vector<unsigned> m_subCells;
+    std::vector<std::size_t> m_offsets;
+    float m_margin;
+  };
+
   class BaseMap : public game::Entity {
   public:
     BaseMap(int priority);
@@ -51,6 +112,10 @@ namespace akgr {
       return m_grid_unit;
     }
 
+    float getSubUnit() const {
+      return static_cast<float>(m_grid_unit) / CellVertices::SUBDIVISION;
+    }
+
     typedef boost::iterator_range<boost::range_detail::integer_iterator<unsigned>> Range;
 
     Range getXRange() const;
@@ -73,22 +138,56 @@ namespace akgr {
       return m_dirty;
     }
 
+    /*
+     * The cells around the focus, in the order they entered the window
+     */
+    const std::vector<std::size_t>& getVisibleCells() const {
+      return m_visible;
+    }
+
     static unsigned computeGridSize(unsigned map_size, unsigned grid_unit);
 
+    /*
+     * The clip of a cell in the view, the global cell is never clipped
+     */
+    CellClip getCellClip(std::size_t index, const sf::FloatRect& view) const;
+
+    static sf::FloatRect getViewRect(const sf::View& view);
+
+    /*
+     * Prepare the cells that are about to be visible, on the current floor
+     */
+    virtual void prefetchCells(const std::vector<std::size_t>& cells);
+
   private:
     game::EventStatus onHeroLocation(game::EventType type, game::Event *event);
 
+    void updateVisibleCells();
+    void updatePrefetch(sf::Vector2f pos);
+
   private:
     unsigned m_grid_width;
     unsigned m_grid_height;
     unsigned m_grid_unit;
     unsigned m_focus_x;
     unsigned m_focus_y;
+    unsigned m_prefetch_x;
+    unsigned m_prefetch_y;
     int m_floor;
     bool m_dirty;
+    std::vector<std::size_t> m_visible;
   };
 
-  template<typename T>
+  /*
+   * A map of objects in a grid, stored by floor and by cell. The objects of
+   * a cell on a floor are turned into some data V (e.g. vertices) the first
+   * time the cell is visible on this floor, and kept for the next times.
+   * Only the cells that have objects are stored.
+   *
+   * An extra global cell, after the cells of the grid, holds the objects
+   * that are too big for a cell. It is always visible.
+   */
+  template<typename T, typename V>
   class GridMap : public BaseMap {
   public:
 
@@ -104,7 +203,44 @@ namespace akgr {
       unsigned y = pos.y / getGridUnit();
 
       std::size_t index = y * getGridWidth() + x;
-      m_content[index].push_back(obj);
+      Cell& cell = getCell(obj.floor, index);
+      resetCell(cell);
+      cell.objects.push_back(obj);
+      setDirty();
+    }
+
+    void addObject(const T& obj, std::size_t index) {
+      Cell& cell = getCell(obj.floor, index);
+      resetCell(cell);
+      cell.objects.push_back(obj);
+      setDirty();
+    }
+
+    template<typename Iterator>
+    void addObjects(std::size_t index, Iterator first, Iterator last) {
+      for (; first != last; ++first) {
+        Cell& cell = getCell(first->floor, index);
+        resetCell(cell);
+        cell.objects.push_back(*first);
+      }
+
+      setDirty();
+    }
+
+    /*
+     * Remove the objects of a cell on all the floors, and release their memory
+     */
+    void clearCell(std::size_t index) {
+      for (auto& item : m_floors) {
+        auto it = item.second.find(index);
+
+        if (it != item.second.end()) {
+          resetCell(it->second);
+          item.second.erase(it);
+        }
+      }
+
+      setDirty();
     }
 
   protected:
@@ -114,27 +250,179 @@ namespace akgr {
 
       BaseMap::initialize(grid_width, grid_height, grid_unit);
 
-      assert(m_content.empty());
-      m_content.resize(grid_width * grid_height);
+      assert(m_floors.empty());
+    }
+
+    std::size_t getGlobalCell() const {
+      return getGridWidth() * getGridHeight();
     }
 
     template<typename Func>
     void processObjects(Func func) {
-      for (auto y : getYRange()) {
-        unsigned start = y * getGridWidth();
+      auto it = m_floors.find(getFloor());
+
+      if (it == m_floors.end()) {
+        return;
+      }
+
+      visitCells(it->second, [&](std::size_t index, Cell& cell) {
+        for (auto& obj : cell.objects) {
+          func(obj);
+        }
+      });
+    }
+
+    /*
+     * Build the data of the visible cells that have not been built yet on the current floor
+     */
+    void buildVisibleCells() {
+      auto it = m_floors.find(getFloor());
+
+      if (it == m_floors.end()) {
+        return;
+      }
 
-        for (auto x : getXRange()) {
-          auto& vec = m_content.at(start + x);
+      visitCells(it->second, [&](std::size_t index, Cell& cell) {
+        if (!cell.built) {
+          if (cell.pending.valid()) {
+            cell.data = cell.pending.get();
+          } else {
+            cell.data = V();
+            buildCell(cell.objects, cell.data);
+          }
+
+          uploadCell(cell.data);
+          cell.built = true;
+        }
+      });
+    }
+
+    virtual void prefetchCells(const std::vector<std::size_t>& cells) override {
+      auto it = m_floors.find(getFloor());
+
+      if (it == m_floors.end()) {
+        return;
+      }
+
+      for (auto index : cells) {
+        auto cellIt = it->second.find(index);
+
+        if (cellIt == it->second.end()) {
+          continue;
+        }
+
+        Cell& cell = cellIt->second;
 
-          for (auto& obj : vec) {
-            func(obj);
+        if (cell.built || cell.pending.valid()) {
+          continue;
+        }
+
+        const std::vector<T> *objects = &cell.objects;
+
+        // on the worker threads of the resources, not on a thread per cell
+        cell.pending = gResourceManager().runJob<V>([this, objects]() {
+          V data;
+          buildCell(*objects, data);
+          return data;
+        });
+      }
+    }
+
+    template<typename Func>
+    void processVisibleCells(const sf::View& view, Func func) const {
+      auto it = m_floors.find(getFloor());
+
+      if (it == m_floors.end()) {
+        return;
+      }
+
+      sf::FloatRect rect = getViewRect(view);
+
+      visitCells(it->second, [&](std::size_t index, const Cell& cell) {
+        if (cell.built) {
+          func(cell.data, getCellClip(index, rect));
+        }
+      });
+    }
+
+    /*
+     * Wait for the prefetched cells, to be called in the destructor of the
+     * derived class, as the prefetch uses buildCell()
+     */
+    void waitForPrefetch() {
+      for (auto& item : m_floors) {
+        for (auto& cell : item.second) {
+          if (cell.second.pending.valid()) {
+            cell.second.pending.wait();
           }
         }
       }
     }
 
+    /*
+     * The objects are all on the same floor. It may be called on a
+     * background thread, for a prefetch.
+     */
+    virtual void buildCell(const std::vector<T>& objects, V& data) const = 0;
+
+    /*
+     * Called on the main thread, when the data of a cell has been built,
+     * e.g. to send it to the GPU.
+     */
+    virtual void uploadCell(V& data) {
+    }
+
+  private:
+    struct Cell {
+      Cell()
+      : built(false)
+      {
+      }
+
+      std::vector<T> objects;
+      bool built;
+      V data;
+      std::future<V> pending;
+    };
+
+    static void resetCell(Cell& cell) {
+      if (cell.pending.valid()) {
+        cell.pending.wait();
+        cell.pending = std::future<V>();
+      }
+
+      cell.built = false;
+    }
+
+    typedef std::unordered_map<std::size_t, Cell> Cells;
+
+    Cell& getCell(int floor, std::size_t index) {
+      assert(index <= getGlobalCell());
+      return m_floors[floor][index];
+    }
+
+    /*
+     * Visit the visible cells and the global cell, the empty cells are skipped
+     */
+    template<typename C, typename Func>
+    void visitCells(C& cells, Func func) const {
+      auto visit = [&](std::size_t index) {
+        auto it = cells.find(index);
+
+        if (it != cells.end()) {
+          func(index, it->second);
+        }
+      };
+
+      for (auto index : getVisibleCells()) {
+        visit(index);
+      }
+
+      visit(getGlobalCell());
+    }
+
   private:
-    std::vector<std::vector<T>> m_content;
+    std::map<int, Cells> m_floors;
   };
 
 
@@ -31,6 +31,8 @@
 
 namespace akgr {
 
+  const char *Hero::HERO_TEXTURE = "sprites/kalista.png";
+
   Hero::Hero(const Location& loc)
   : game::Entity(1)
   , m_linear(Linear::STOP), m_angular(Angular::STOP)
@@ -42,31 +44,46 @@ namespace akgr {
     data.rectangle.height = 55;
     m_body = gPhysicsModel().createHeroBody(loc, &data);
 
-    auto texture = gResourceManager().getTexture("sprites/kalista.png");
-    assert(texture);
-    texture->setSmooth(true);
-
-    m_staticAnimation.addFrame(texture, { 0, 0, 64, 64 }, 1.0f);
-
-    m_forwardAnimation.addFrame(texture, {   0, 0, 64, 64 }, 0.15f);
-    m_forwardAnimation.addFrame(texture, {  64, 0, 64, 64 }, 0.20f);
-    m_forwardAnimation.addFrame(texture, {   0, 0, 64, 64 }, 0.15f);
-    m_forwardAnimation.addFrame(texture, { 128, 0, 64, 64 }, 0.20f);
-
-    m_backwardAnimation.addFrame(texture, {   0, 0, 64, 64 }, 0.20f);
-    m_backwardAnimation.addFrame(texture, { 128, 0, 64, 64 }, 0.30f);
-    m_backwardAnimation.addFrame(texture, {   0, 0, 64, 64 }, 0.20f);
-    m_backwardAnimation.addFrame(texture, {  64, 0, 64, 64 }, 0.30f);
-
     gEventManager().registerHandler<MoveUpEvent>(&Hero::onMoveUp, this);
     gEventManager().registerHandler<MoveDownEvent>(&Hero::onMoveDown, this);
     gEventManager().registerHandler<MoveInsideEvent>(&Hero::onMoveInside, this);
     gEventManager().registerHandler<MoveOutsideEvent>(&Hero::onMoveOutside, this);
   }
 
-  void Hero::broadcastLocation() {
+  void Hero::loadAnimations() {
+    auto texture = gTextureAtlas().getTexture(HERO_TEXTURE);
+    sf::Vector2i offset(0, 0);
+
+    if (texture != nullptr) {
+      offset = gTextureAtlas().getPosition(HERO_TEXTURE);
+    } else {
+      texture = gResourceManager().getTexture(HERO_TEXTURE);
+      assert(texture);
+      texture->setSmooth(true);
+    }
+
+    auto frame = [offset](int left, int top) {
+      return sf::IntRect(offset.x + left, offset.y + top, 64, 64);
+    };
+
+    m_staticAnimation.addFrame(texture, frame(0, 0), 1.0f);
+
+    m_forwardAnimation.addFrame(texture, frame(  0, 0), 0.15f);
+    m_forwardAnimation.addFrame(texture, frame( 64, 0), 0.20f);
+    m_forwardAnimation.addFrame(texture, frame(  0, 0), 0.15f);
+    m_forwardAnimation.addFrame(texture, frame(128, 0), 0.20f);
+
+    m_backwardAnimation.addFrame(texture, frame(  0, 0), 0.20f);
+    m_backwardAnimation.addFrame(texture, frame(128, 0), 0.30f);
+    m_backwardAnimation.addFrame(texture, frame(  0, 0), 0.20f);
+    m_backwardAnimation.addFrame(texture, frame( 64, 0), 0.30f);
+  }
+
+  void Hero::broadcastLocation(float dt) {
     HeroLocationEvent event;
     event.loc = m_body.getLocation();
+    event.velocity = m_body.getVelocity();
+    event.dt = dt;
     gEventManager().triggerEvent(&event);
   }
 
@@ -111,13 +128,13 @@ namespace akgr {
     assert(m_currentAnimation);
     m_currentAnimation->update(dt);
 
-    broadcastLocation();
+    broadcastLocation(dt);
   }
 
   static constexpr float PI_2 = 1.57079632679489661923f;
 
-  void Hero::render(sf::RenderWindow& window) {
-    m_currentAnimation->renderAt(window, getPosition(), m_body.getAngle() / PI_2 * 90.0f);
+  void Hero::render(game::RenderQueue& queue) {
+    m_currentAnimation->renderAt(queue, getPriority(), m_body.getInterpolatedPosition(), m_body.getInterpolatedAngle() / PI_2 * 90.0f);
   }
 
   game::EventStatus Hero::onMoveUp(game::EventType type, game::Event *event) {
@@ -34,12 +34,23 @@ namespace akgr {
 
   class Hero : public game::Entity {
   public:
+    static const char *HERO_TEXTURE;
+
     Hero(const Location& loc = { { 100.0f, 100.0f }, 0 });
 
+    /*
+     * The animations need the textures, they are not loaded in headless mode
+     */
+    void loadAnimations();
+
     sf::Vector2f getPosition() const {
       return m_body.getPosition();
     }
 
+    sf::Vector2f getInterpolatedPosition() const {
+      return m_body.getInterpolatedPosition();
+    }
+
     Location getLocation() const {
       return m_body.getLocation();
     }
@@ -68,10 +79,13 @@ namespace akgr {
       m_angular = Angular::RIGHT;
     }
 
-    void broadcastLocation();
+    /*
+     * The duration of the frame that moved the hero, 0 when the hero is placed
+     */
+    void broadcastLocation(float dt = 0.0f);
 
     virtual void update(float dt) override;
-    virtual void render(sf::RenderWindow& window) override;
+    virtual void render(game::RenderQueue& queue) override;
 
   private:
     Body m_body;
@@ -82,7 +82,9 @@ namespace akgr {
 
   static constexpr std::size_t BUFFER_SIZE = 1024;
 
-  static void drawBar(sf::RenderWindow& window, float x, float y, float points, sf::Color color) {
+  static constexpr int ATTR_PRIORITY = 0;
+
+  static void drawBar(game::RenderQueue& queue, float x, float y, float points, sf::Color color) {
     sf::Color gray(0x80, 0x80, 0x80);
 
     sf::RectangleShape rect({ ATTR_WIDTH, ATTR_HEIGHT });
@@ -90,50 +92,55 @@ namespace akgr {
     rect.setFillColor(gray);
     rect.setOutlineThickness(1.0f);
     rect.setOutlineColor(gray);
-    window.draw(rect);
+    queue.addDrawable(ATTR_PRIORITY, rect);
 
     rect.setSize({ points * ATTR_WIDTH, ATTR_HEIGHT });
     rect.setFillColor(color);
-    window.draw(rect);
+    queue.addDrawable(ATTR_PRIORITY, rect);
   }
 
-  static void drawName(sf::RenderWindow& window, sf::Font& font, float x, float y, const char *name) {
-    sf::Text text;
-    text.setCharacterSize(ATTR_SIZE);
-    text.setFont(font);
-    text.setString(name);
-    auto bounds = text.getLocalBounds();
-    text.setOrigin(bounds.left, bounds.top);
+  static void drawShadowedText(sf::RenderTarget& target, sf::Text& text) {
     text.setColor(sf::Color::Black);
-    text.setPosition(x, y);
-    window.draw(text);
+    target.draw(text);
 
     text.setColor(sf::Color::White);
     text.move(ATTR_SHIFT, ATTR_SHIFT);
-    window.draw(text);
+    target.draw(text);
   }
 
-  static void drawNumbers(sf::RenderWindow& window, sf::Font& font, float x, float y, int points, int pointsMax) {
-    std::array<char, BUFFER_SIZE> buffer;
+  static void drawName(game::RenderQueue& queue, sf::Font& font, float x, float y, const char *name) {
+    // the text is laid out when it is drawn, the font is only used on the render thread
+    queue.addCustom(ATTR_PRIORITY, [&font, x, y, name](sf::RenderTarget& target) {
+      sf::Text text;
+      text.setCharacterSize(ATTR_SIZE);
+      text.setFont(font);
+      text.setString(name);
+      auto bounds = text.getLocalBounds();
+      text.setOrigin(bounds.left, bounds.top);
+      text.setPosition(x, y);
+      drawShadowedText(target, text);
+    });
+  }
 
+  static void drawNumbers(game::RenderQueue& queue, sf::Font& font, float x, float y, int points, int pointsMax) {
+    std::array<char, BUFFER_SIZE> buffer;
     std::snprintf(buffer.data(), buffer.size(), "%i/%i", points, pointsMax);
-    sf::Text text;
-    text.setCharacterSize(ATTR_SIZE);
-    text.setFont(font);
-    text.setString(buffer.data());
-    auto bounds = text.getLocalBounds();
-    text.setOrigin(bounds.left + bounds.width / 2, bounds.top + bounds.height / 2);
-    text.setColor(sf::Color::Black);
-    text.setPosition(x, y);
-    window.draw(text);
-
-    text.setColor(sf::Color::White);
-    text.move(ATTR_SHIFT, ATTR_SHIFT);
-    window.draw(text);
+    std::string str(buffer.data());
+
+    queue.addCustom(ATTR_PRIORITY, [&font, x, y, str](sf::RenderTarget& target) {
+      sf::Text text;
+      text.setCharacterSize(ATTR_SIZE);
+      text.setFont(font);
+      text.setString(str);
+      auto bounds = text.getLocalBounds();
+      text.setOrigin(bounds.left + bounds.width / 2, bounds.top + bounds.height / 2);
+      text.setPosition(x, y);
+      drawShadowedText(target, text);
+    });
   }
 
 
-  void HeroAttributes::render(sf::RenderWindow& window) {
+  void HeroAttributes::render(game::RenderQueue& queue) {
     float d = (ATTR_HEIGHT + 2.0f - ATTR_SIZE) / 2 - ATTR_SHIFT / 2;
     float mx = ATTR_MARGIN_X + (ATTR_WIDTH - ATTR_SHIFT) / 2;
     float my = ATTR_MARGIN_Y + (ATTR_HEIGHT - ATTR_SHIFT) / 2;
@@ -141,16 +148,16 @@ namespace akgr {
     // HP
 
     float hp = static_cast<float>(m_healthPoints) / static_cast<float>(m_healthPointsMax);
-    drawBar(window, ATTR_MARGIN_X, ATTR_MARGIN_Y, hp, sf::Color(0xFF, 0x80, 0x80));
-    drawName(window, *m_font, ATTR_MARGIN_X + d, ATTR_MARGIN_Y + d, "HP");
-    drawNumbers(window, *m_font, mx, my, m_healthPoints, m_healthPointsMax);
+    drawBar(queue, ATTR_MARGIN_X, ATTR_MARGIN_Y, hp, sf::Color(0xFF, 0x80, 0x80));
+    drawName(queue, *m_font, ATTR_MARGIN_X + d, ATTR_MARGIN_Y + d, "HP");
+    drawNumbers(queue, *m_font, mx, my, m_healthPoints, m_healthPointsMax);
 
     // MP
 
     float mp = static_cast<float>(m_magicPoints) / static_cast<float>(m_magicPointsMax);
-    drawBar(window, ATTR_MARGIN_X, ATTR_MARGIN_Y + ATTR_HEIGHT + ATTR_MARGIN, mp, sf::Color(0x80, 0x80, 0xFF));
-    drawName(window, *m_font, ATTR_MARGIN_X + d, ATTR_MARGIN_Y + ATTR_HEIGHT + ATTR_MARGIN + d, "MP");
-    drawNumbers(window, *m_font, mx, my + ATTR_HEIGHT + ATTR_MARGIN, m_magicPoints, m_magicPointsMax);
+    drawBar(queue, ATTR_MARGIN_X, ATTR_MARGIN_Y + ATTR_HEIGHT + ATTR_MARGIN, mp, sf::Color(0x80, 0x80, 0xFF));
+    drawName(queue, *m_font, ATTR_MARGIN_X + d, ATTR_MARGIN_Y + ATTR_HEIGHT + ATTR_MARGIN + d, "MP");
+    drawNumbers(queue, *m_font, mx, my + ATTR_HEIGHT + ATTR_MARGIN, m_magicPoints, m_magicPointsMax);
   }
 
 }
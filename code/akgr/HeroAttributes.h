@@ -43,7 +43,7 @@ namespace akgr {
     void increaseMP(float percent);
 
     virtual void update(float dt) override;
-    virtual void render(sf::RenderWindow& window) override;
+    virtual void render(game::RenderQueue& queue) override;
 
   private:
     sf::Font *m_font;
@@ -0,0 +1,993 @@
+/*
+ * Akagoria, the revenge of Kalista
+ * a single-player RPG in an open world with a top-down view.
+ *
+ * Copyright (c) 2013-2015, Julien Bernard
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "MapCache.h"
+
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <map>
+#include <regex>
+
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/classification.hpp> // for is_any_of
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <tmx/LayerVisitor.h>
+#include <tmx/Object.h>
+#include <tmx/ObjectLayer.h>
+#include <tmx/TileLayer.h>
+
+#include <game/Log.h>
+
+namespace akgr {
+
+  static constexpr char CACHE_MAGIC[8] = { 'A', 'K', 'G', 'R', 'M', 'A', 'P', '\0' };
+  static constexpr uint32_t CACHE_BYTE_ORDER = 0x01020304;
+  static constexpr uint32_t NO_STRING = UINT32_MAX;
+  static constexpr std::size_t ALIGNMENT = 8;
+
+  namespace {
+
+    struct Header {
+      char magic[8];
+      uint32_t version;
+      uint32_t byteOrder;
+      uint32_t width;
+      uint32_t height;
+      uint32_t gridUnit;
+      uint32_t gridWidth;
+      uint32_t gridHeight;
+      uint32_t layerOffset;
+      uint32_t layerCount;
+      uint32_t pointOffset;
+      uint32_t pointCount;
+      uint32_t requirementOffset;
+      uint32_t requirementCount;
+      uint32_t stringOffset;
+      uint32_t stringCount;
+    };
+
+    unsigned computeGridSize(unsigned size, unsigned unit) {
+      return size / unit + (size % unit == 0 ? 0 : 1);
+    }
+
+    std::string makeRelative(const boost::filesystem::path& source, const boost::filesystem::path& base) {
+      auto sourceIt = source.begin();
+      auto baseIt = base.begin();
+
+      while (baseIt != base.end() && sourceIt != source.end() && *sourceIt == *baseIt) {
+        ++sourceIt;
+        ++baseIt;
+      }
+
+      if (baseIt != base.end()) {
+        return source.string();
+      }
+
+      boost::filesystem::path relative;
+
+      for (; sourceIt != source.end(); ++sourceIt) {
+        relative /= *sourceIt;
+      }
+
+      return relative.string();
+    }
+
+    /*
+     * The files referenced by a map or an external tileset, i.e. the
+     * external tilesets and the images
+     */
+    void findSources(const boost::filesystem::path& path, std::vector<boost::filesystem::path>& sources) {
+      std::ifstream file(path.string());
+      std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+      static const std::regex source("<(?:tileset|image)\\b[^>]*\\bsource=\"([^\"]*)\"");
+
+      for (std::sregex_iterator it(content.begin(), content.end(), source), end; it != end; ++it) {
+        boost::filesystem::path referenced((*it)[1].str());
+
+        if (referenced.is_relative()) {
+          referenced = path.parent_path() / referenced;
+        }
+
+        if (std::find(sources.begin(), sources.end(), referenced) == sources.end()) {
+          sources.push_back(referenced);
+        }
+      }
+    }
+
+    tmx::Size getImageSize(const tmx::Image *image) {
+      if (image->hasSize()) {
+        return image->getSize();
+      }
+
+      tmx::Size size = { 0, 0 };
+      sf::Image data;
+
+      if (data.loadFromFile(image->getSource().string())) {
+        sf::Vector2u imageSize = data.getSize();
+        size.width = imageSize.x;
+        size.height = imageSize.y;
+      } else {
+        game::Log::error(game::Log::RESOURCES, "Could not load the tileset image: '%s'\n", image->getSource().string().c_str());
+      }
+
+      return size;
+    }
+
+    /*
+     * Sort the objects by cell, keeping the order inside a cell. The last
+     * cell is for the objects that do not fit in one cell.
+     */
+    template<typename T>
+    void sortByCell(const std::vector<T>& objects, const std::vector<uint32_t>& objectCells, std::size_t cellCount, std::vector<uint32_t>& cells, std::vector<T>& sorted) {
+      assert(objects.size() == objectCells.size());
+      cells.assign(cellCount + 2, 0);
+
+      for (auto cell : objectCells) {
+        assert(cell <= cellCount);
+        cells[cell + 1]++;
+      }
+
+      for (std::size_t i = 0; i <= cellCount; ++i) {
+        cells[i + 1] += cells[i];
+      }
+
+      std::vector<uint32_t> next(cells.begin(), cells.end() - 1);
+      sorted.resize(objects.size());
+
+      for (std::size_t i = 0; i < objects.size(); ++i) {
+        sorted[next[objectCells[i]]++] = objects[i];
+      }
+    }
+
+    struct MapCacheBuilder : public tmx::LayerVisitor {
+      struct LayerData {
+        MapCache::Layer layer;
+        std::vector<uint32_t> cells;
+        std::vector<Tile> tiles;
+        std::vector<MapCache::SpriteRecord> sprites;
+        std::vector<MapCache::ZoneRecord> zones;
+        std::vector<MapCache::PointOfInterestRecord> pois;
+        std::string texture;
+      };
+
+      MapCacheBuilder(const boost::filesystem::path& base, unsigned gridWidth, unsigned gridHeight)
+      : m_base(base)
+      , m_gridWidth(gridWidth)
+      , m_gridHeight(gridHeight)
+      {
+
+      }
+
+      uint32_t addString(const std::string& str) {
+        auto it = m_stringIndices.find(str);
+
+        if (it != m_stringIndices.end()) {
+          return it->second;
+        }
+
+        uint32_t index = strings.size();
+        strings.push_back(str);
+        m_stringIndices.insert(std::make_pair(str, index));
+        return index;
+      }
+
+      LayerData *createLayer(const tmx::Layer& layer, MapCache::LayerType type, const std::string& kind, int floor) {
+        layers.emplace_back();
+        LayerData *data = &layers.back();
+        data->layer.kind = game::Hash(kind);
+        data->layer.floor = floor;
+        data->layer.type = type;
+        data->layer.name = addString(layer.getName());
+        data->layer.texture = NO_STRING;
+        data->layer.index = 0;
+        data->layer.offset = 0;
+        data->layer.count = 0;
+        return data;
+      }
+
+      /*
+       * An object is in the cell of its center if it is not bigger than a
+       * cell, so that it is loaded with the neighbour cells of the hero
+       */
+      uint32_t getCell(float xmin, float ymin, float xmax, float ymax) const {
+        uint32_t globalCell = m_gridWidth * m_gridHeight;
+
+        if (xmax - xmin > MapCache::GRID_UNIT || ymax - ymin > MapCache::GRID_UNIT) {
+          return globalCell;
+        }
+
+        float cx = (xmin + xmax) / 2;
+        float cy = (ymin + ymax) / 2;
+
+        if (cx < 0.0f || cy < 0.0f) {
+          return globalCell;
+        }
+
+        unsigned x = cx / MapCache::GRID_UNIT;
+        unsigned y = cy / MapCache::GRID_UNIT;
+
+        if (x >= m_gridWidth || y >= m_gridHeight) {
+          return globalCell;
+        }
+
+        return y * m_gridWidth + x;
+      }
+
+      virtual void visitTileLayer(const tmx::Map& map, const tmx::TileLayer& layer) override {
+        if (!layer.hasProperty("kind")) {
+          game::Log::warning(game::Log::GRAPHICS, "No kind for the layer: '%s'\n", layer.getName().c_str());
+          return;
+        }
+
+        const std::string& kind = layer.getProperty("kind", "");
+        int floor = std::stoi(layer.getProperty("floor", "0"));
+
+        LayerData *data = createLayer(layer, MapCache::LayerType::TILE, kind, floor);
+
+        // the tile layers are the biggest part of the map, bake them in the background
+        m_tasks.push_back(std::async(std::launch::async, [this, &map, &layer, data]() {
+          bakeTileLayer(map, layer, data);
+        }));
+      }
+
+      void bakeTileLayer(const tmx::Map& map, const tmx::TileLayer& layer, LayerData *data) {
+        int floor = data->layer.floor;
+
+        game::Log::info(game::Log::GRAPHICS, "Baking tile layer: '%s' (floor: %i)\n", layer.getName().c_str(), floor);
+
+        unsigned tileWidth = map.getTileWidth();
+        assert(tileWidth);
+
+        unsigned tileHeight = map.getTileHeight();
+        assert(tileHeight);
+
+        unsigned width = map.getWidth();
+        assert(width);
+
+        unsigned height = map.getHeight();
+        assert(height);
+
+        std::vector<Tile> tiles;
+        std::vector<uint32_t> tileCells;
+        std::string texture;
+        tmx::Size size = { 0, 0 };
+
+        unsigned k = 0;
+
+        for (auto cell : layer) {
+          unsigned i = k % width;
+          unsigned j = k / width;
+          assert(j < height);
+          k++;
+
+          unsigned gid = cell.getGID();
+
+          if (gid == 0) {
+            continue;
+          }
+
+          auto tileset = map.getTileSetFromGID(gid);
+          auto image = tileset->getImage();
+
+          if (texture.empty()) {
+            assert(tileset->getTileWidth() == tileWidth);
+            assert(tileset->getTileHeight() == tileHeight);
+
+            texture = makeRelative(image->getSource(), m_base);
+            size = getImageSize(image);
+          } else {
+            assert(texture == makeRelative(image->getSource(), m_base));
+          }
+
+          gid = gid - tileset->getFirstGID();
+          tmx::Rect rect = tileset->getCoords(gid, size);
+
+          Tile tile;
+
+          tile.floor = floor;
+
+          // define its 4 corners
+          tile.position[0] = sf::Vector2f(i * tileWidth, j * tileHeight);
+          tile.position[1] = sf::Vector2f((i + 1) * tileWidth, j * tileHeight);
+          tile.position[2] = sf::Vector2f((i + 1) * tileWidth, (j + 1) * tileHeight);
+          tile.position[3] = sf::Vector2f(i * tileWidth, (j + 1) * tileHeight);
+
+          // define its 4 texture coordinates
+          tile.texCoords[0] = sf::Vector2f(rect.x, rect.y);
+          tile.texCoords[1] = sf::Vector2f(rect.x + rect.width, rect.y);
+          tile.texCoords[2] = sf::Vector2f(rect.x + rect.width, rect.y + rect.height);
+          tile.texCoords[3] = sf::Vector2f(rect.x, rect.y + rect.height);
+
+          sf::Vector2f center = (tile.position[0] + tile.position[2]) / 2.0f;
+          unsigned x = center.x / MapCache::GRID_UNIT;
+          unsigned y = center.y / MapCache::GRID_UNIT;
+          assert(x < m_gridWidth && y < m_gridHeight);
+
+          tiles.push_back(tile);
+          tileCells.push_back(y * m_gridWidth + x);
+        }
+
+        sortByCell(tiles, tileCells, m_gridWidth * m_gridHeight, data->cells, data->tiles);
+
+        data->texture = texture;
+
+        game::Log::info(game::Log::GRAPHICS, "\tTiles baked: %zu\n", data->tiles.size());
+      }
+
+      virtual void visitObjectLayer(const tmx::Map& map, const tmx::ObjectLayer& layer) override {
+        if (!layer.hasProperty("kind")) {
+          game::Log::warning(game::Log::GRAPHICS, "No kind for the layer: '%s'\n", layer.getName().c_str());
+          return;
+        }
+
+        const std::string& kind = layer.getProperty("kind", "");
+        int floor = std::stoi(layer.getProperty("floor", "0"));
+
+        switch (game::Hash(kind)) {
+          case "zone"_id:
+            bakeZoneLayer(layer, kind, floor);
+            break;
+          case "poi"_id:
+            bakePointOfInterestLayer(layer, kind, floor);
+            break;
+          default:
+            bakeSpriteLayer(map, layer, kind, floor);
+            break;
+        }
+      }
+
+      void bakeSpriteLayer(const tmx::Map& map, const tmx::ObjectLayer& layer, const std::string& kind, int floor) {
+        game::Log::info(game::Log::GRAPHICS, "Baking sprite layer: '%s' (floor: %i)\n", layer.getName().c_str(), floor);
+
+        LayerData *data = createLayer(layer, MapCache::LayerType::SPRITE, kind, floor);
+
+        std::vector<MapCache::SpriteRecord> sprites;
+        std::vector<uint32_t> spriteCells;
+
+        for (auto obj : layer) {
+          const std::string& name = obj->getName();
+
+          if (!obj->isTile()) {
+            game::Log::warning(game::Log::GRAPHICS, "Object is not a tile: '%s'\n", name.c_str());
+            continue;
+          }
+
+          auto tile = static_cast<const tmx::TileObject *>(obj);
+
+          unsigned gid = tile->getGID();
+          assert(gid != 0);
+
+          auto tileset = map.getTileSetFromGID(gid);
+          auto image = tileset->getImage();
+          tmx::Size size = getImageSize(image);
+
+          gid = gid - tileset->getFirstGID();
+          tmx::Rect rect = tileset->getCoords(gid, size);
+
+          auto angle = tile->getRotation();
+
+          sf::Vector2f center;
+          center.x = tile->getX();
+          center.y = tile->getY();
+
+          sf::Transform transform;
+          transform.rotate(angle, center);
+
+          sf::Vector2f pos;
+          pos.x = tile->getX() + rect.width / 2;
+          pos.y = tile->getY() - tileset->getTileHeight() + rect.height / 2;
+          pos = transform.transformPoint(pos);
+
+          MapCache::SpriteRecord sprite;
+          sprite.id = game::Hash(name);
+          sprite.angle = angle;
+          sprite.x = pos.x;
+          sprite.y = pos.y;
+          sprite.left = rect.x;
+          sprite.top = rect.y;
+          sprite.width = rect.width;
+          sprite.height = rect.height;
+          sprite.texture = addString(makeRelative(image->getSource(), m_base));
+          sprite.name = addString(name);
+
+          sprites.push_back(sprite);
+          spriteCells.push_back(getCell(pos.x, pos.y, pos.x, pos.y));
+        }
+
+        sortByCell(sprites, spriteCells, m_gridWidth * m_gridHeight, data->cells, data->sprites);
+
+        game::Log::info(game::Log::GRAPHICS, "\tSprites baked: %zu\n", data->sprites.size());
+      }
+
+      void bakeZoneLayer(const tmx::ObjectLayer& layer, const std::string& kind, int floor) {
+        game::Log::info(game::Log::PHYSICS, "Baking zone layer: '%s' (floor: %i)\n", layer.getName().c_str(), floor);
+
+        LayerData *data = createLayer(layer, MapCache::LayerType::ZONE, kind, floor);
+
+        std::vector<MapCache::ZoneRecord> zones;
+        std::vector<uint32_t> zoneCells;
+
+        for (auto obj : layer) {
+          const std::string& name = obj->getName();
+
+          MapCache::ZoneRecord zone;
+          zone.name = addString(name);
+          zone.event = NO_STRING;
+          zone.firstRequirement = requirements.size();
+          zone.requirementCount = 0;
+
+          if (obj->getType() == "event") {
+            if (!obj->hasProperty("id")) {
+              game::Log::warning(game::Log::PHYSICS, "No event id for the object: '%s'\n", name.c_str());
+              continue;
+            }
+
+            zone.type = MapCache::ZoneType::EVENT;
+            zone.event = addString(obj->getProperty("id", ""));
+
+            std::string requirementString = obj->getProperty("requirements", "");
+            std::vector<std::string> requirementList;
+            boost::algorithm::split(requirementList, requirementString, boost::algorithm::is_any_of(", "), boost::algorithm::token_compress_on);
+
+            for (auto& requirement : requirementList) {
+              if (!requirement.empty()) {
+                requirements.push_back(game::Hash(requirement));
+              }
+            }
+
+            zone.requirementCount = requirements.size() - zone.firstRequirement;
+          } else if (obj->getType() == "collision") {
+            zone.type = MapCache::ZoneType::COLLISION;
+          } else {
+            game::Log::warning(game::Log::PHYSICS, "No type for the object: '%s'\n", name.c_str());
+            continue;
+          }
+
+          zone.x = obj->getX();
+          zone.y = obj->getY();
+          zone.width = zone.height = 0.0f;
+          zone.firstPoint = points.size();
+          zone.pointCount = 0;
+
+          // bounding box, to find the cell of the zone
+          float xmin = zone.x;
+          float ymin = zone.y;
+          float xmax = zone.x;
+          float ymax = zone.y;
+
+          if (obj->isRectangle()) {
+            auto rectangleObject = static_cast<const tmx::Rectangle *>(obj);
+            zone.shape = MapCache::ZoneShape::RECTANGLE;
+            zone.width = rectangleObject->getWidth();
+            zone.height = rectangleObject->getHeight();
+            xmax += zone.width;
+            ymax += zone.height;
+          } else if (obj->isChain()) {
+            auto chainObject = static_cast<const tmx::Chain *>(obj);
+            zone.shape = obj->isPolygon() ? MapCache::ZoneShape::LOOP : MapCache::ZoneShape::CHAIN;
+
+            for (auto point : *chainObject) {
+              MapCache::PointRecord record = { static_cast<float>(point.x), static_cast<float>(point.y) };
+              points.push_back(record);
+              xmin = std::min(xmin, zone.x + record.x);
+              ymin = std::min(ymin, zone.y + record.y);
+              xmax = std::max(xmax, zone.x + record.x);
+              ymax = std::max(ymax, zone.y + record.y);
+            }
+
+            zone.pointCount = points.size() - zone.firstPoint;
+          } else {
+            game::Log::warning(game::Log::PHYSICS, "A zone could not be transformed into a fixture: '%s'\n", name.c_str());
+            requirements.resize(zone.firstRequirement);
+            continue;
+          }
+
+          zones.push_back(zone);
+          zoneCells.push_back(getCell(xmin, ymin, xmax, ymax));
+        }
+
+        sortByCell(zones, zoneCells, m_gridWidth * m_gridHeight, data->cells, data->zones);
+
+        game::Log::info(game::Log::PHYSICS, "\tZones baked: %zu\n", data->zones.size());
+      }
+
+      void bakePointOfInterestLayer(const tmx::ObjectLayer& layer, const std::string& kind, int floor) {
+        game::Log::info(game::Log::RESOURCES, "Baking POI layer: '%s' (floor: %i)\n", layer.getName().c_str(), floor);
+
+        LayerData *data = createLayer(layer, MapCache::LayerType::POI, kind, floor);
+
+        for (auto obj : layer) {
+          const std::string& name = obj->getName();
+
+          if (!obj->isEllipse()) {
+            game::Log::warning(game::Log::RESOURCES, "Object is not an ellipse: '%s'\n", name.c_str());
+            continue;
+          }
+
+          MapCache::PointOfInterestRecord poi;
+          poi.name = addString(name);
+          poi.x = obj->getX();
+          poi.y = obj->getY();
+          data->pois.push_back(poi);
+        }
+
+        game::Log::info(game::Log::RESOURCES, "\tPOI baked: %zu\n", data->pois.size());
+      }
+
+      void finish(const MapCache::ProgressCallback& callback) {
+        unsigned total = m_tasks.size();
+
+        for (unsigned i = 0; i < total; ++i) {
+          m_tasks[i].get();
+
+          if (callback) {
+            callback(i + 1, total);
+          }
+        }
+
+        m_tasks.clear();
+
+        // the strings are added in the order of the layers, whatever the order of completion
+        for (auto& data : layers) {
+          if (!data.texture.empty()) {
+            data.layer.texture = addString(data.texture);
+          }
+        }
+      }
+
+      std::deque<LayerData> layers;
+      std::vector<MapCache::PointRecord> points;
+      std::vector<game::Id> requirements;
+      std::vector<std::string> strings;
+
+    private:
+      boost::filesystem::path m_base;
+      unsigned m_gridWidth;
+      unsigned m_gridHeight;
+      std::map<std::string, uint32_t> m_stringIndices;
+      std::vector<std::future<void>> m_tasks;
+    };
+
+    class Writer {
+    public:
+      Writer(std::vector<char>& buffer)
+      : m_buffer(buffer)
+      {
+      }
+
+      template<typename T>
+      uint32_t append(const T *data, std::size_t count) {
+        m_buffer.resize((m_buffer.size() + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT, '\0');
+        uint32_t offset = m_buffer.size();
+        const char *bytes = reinterpret_cast<const char *>(data);
+        m_buffer.insert(m_buffer.end(), bytes, bytes + count * sizeof(T));
+        return offset;
+      }
+
+    private:
+      std::vector<char>& m_buffer;
+    };
+
+  }
+
+  MapCache::MapCache()
+  : m_data(nullptr)
+  , m_size(0)
+  {
+
+  }
+
+  MapCache::~MapCache() {
+    // defined here for the destruction of the mapped region
+  }
+
+  bool MapCache::isUpToDate(const boost::filesystem::path& cachePath, const boost::filesystem::path& mapPath) {
+    boost::system::error_code ec;
+
+    auto cacheTime = boost::filesystem::last_write_time(cachePath, ec);
+
+    if (ec) {
+      return false;
+    }
+
+    // the map, its external tilesets and all their images
+    std::vector<boost::filesystem::path> sources = { mapPath };
+
+    for (std::size_t i = 0; i < sources.size(); ++i) {
+      auto sourceTime = boost::filesystem::last_write_time(sources[i], ec);
+
+      if (ec || sourceTime > cacheTime) {
+        return false;
+      }
+
+      if (i == 0 || sources[i].extension() == ".tsx") {
+        findSources(sources[i], sources);
+      }
+    }
+
+    return true;
+  }
+
+  bool MapCache::loadFromFile(const boost::filesystem::path& path) {
+    try {
+      boost::interprocess::file_mapping file(path.string().c_str(), boost::interprocess::read_only);
+      m_region.reset(new boost::interprocess::mapped_region(file, boost::interprocess::read_only));
+    } catch (boost::interprocess::interprocess_exception& ex) {
+      game::Log::error(game::Log::RESOURCES, "Could not map the map cache '%s': %s\n", path.string().c_str(), ex.what());
+      m_region.reset();
+      return false;
+    }
+
+    if (!setData(static_cast<const char *>(m_region->get_address()), m_region->get_size())) {
+      game::Log::warning(game::Log::RESOURCES, "Invalid map cache: '%s'\n", path.string().c_str());
+      m_region.reset();
+      return false;
+    }
+
+    m_base = path.parent_path();
+    game::Log::info(game::Log::RESOURCES, "Map cache loaded: '%s'\n", path.string().c_str());
+    return true;
+  }
+
+  void MapCache::loadFromMap(const tmx::Map& map, const boost::filesystem::path& base, const ProgressCallback& callback) {
+    unsigned width = map.getWidth() * map.getTileWidth();
+    unsigned height = map.getHeight() * map.getTileHeight();
+    unsigned gridWidth = computeGridSize(width, GRID_UNIT);
+    unsigned gridHeight = computeGridSize(height, GRID_UNIT);
+
+    MapCacheBuilder builder(base, gridWidth, gridHeight);
+    map.visitLayers(builder);
+    builder.finish(callback);
+
+    m_region.reset();
+    m_buffer.clear();
+
+    Header header;
+    std::memset(&header, 0, sizeof header);
+
+    Writer writer(m_buffer);
+    writer.append(&header, 1);
+
+    std::vector<Layer> layers;
+
+    for (auto& data : builder.layers) {
+      Layer layer = data.layer;
+
+      switch (layer.type) {
+        case LayerType::TILE:
+          layer.index = writer.append(data.cells.data(), data.cells.size());
+          layer.offset = writer.append(data.tiles.data(), data.tiles.size());
+          layer.count = data.tiles.size();
+          break;
+        case LayerType::SPRITE:
+          layer.index = writer.append(data.cells.data(), data.cells.size());
+          layer.offset = writer.append(data.sprites.data(), data.sprites.size());
+          layer.count = data.sprites.size();
+          break;
+        case LayerType::ZONE:
+          layer.index = writer.append(data.cells.data(), data.cells.size());
+          layer.offset = writer.append(data.zones.data(), data.zones.size());
+          layer.count = data.zones.size();
+          break;
+        case LayerType::POI:
+          layer.offset = writer.append(data.pois.data(), data.pois.size());
+          layer.count = data.pois.size();
+          break;
+      }
+
+      layers.push_back(layer);
+    }
+
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof CACHE_MAGIC);
+    header.version = VERSION;
+    header.byteOrder = CACHE_BYTE_ORDER;
+    header.width = width;
+    header.height = height;
+    header.gridUnit = GRID_UNIT;
+    header.gridWidth = gridWidth;
+    header.gridHeight = gridHeight;
+    header.layerOffset = writer.append(layers.data(), layers.size());
+    header.layerCount = layers.size();
+    header.pointOffset = writer.append(builder.points.data(), builder.points.size());
+    header.pointCount = builder.points.size();
+    header.requirementOffset = writer.append(builder.requirements.data(), builder.requirements.size());
+    header.requirementCount = builder.requirements.size();
+
+    // the characters of the strings are at the end of the file
+    std::vector<uint32_t> stringOffsets(builder.strings.size(), 0);
+    header.stringOffset = writer.append(stringOffsets.data(), stringOffsets.size());
+    header.stringCount = stringOffsets.size();
+
+    for (std::size_t i = 0; i < builder.strings.size(); ++i) {
+      const std::string& str = builder.strings[i];
+      stringOffsets[i] = writer.append(str.c_str(), str.size() + 1);
+    }
+
+    if (!stringOffsets.empty()) {
+      std::memcpy(m_buffer.data() + header.stringOffset, stringOffsets.data(), stringOffsets.size() * sizeof(uint32_t));
+    }
+
+    std::memcpy(m_buffer.data(), &header, sizeof header);
+
+    bool valid = setData(m_buffer.data(), m_buffer.size());
+    assert(valid);
+    (void) valid;
+
+    m_base = base;
+  }
+
+  bool MapCache::saveToFile(const boost::filesystem::path& path) const {
+    if (m_data == nullptr) {
+      return false;
+    }
+
+    std::ofstream file(path.string(), std::ios::binary);
+    file.write(m_data, m_size);
+
+    if (!file) {
+      game::Log::error(game::Log::RESOURCES, "Could not write the map cache: '%s'\n", path.string().c_str());
+      return false;
+    }
+
+    return true;
+  }
+
+  unsigned MapCache::getWidth() const {
+    return reinterpret_cast<const Header *>(m_data)->width;
+  }
+
+  unsigned MapCache::getHeight() const {
+    return reinterpret_cast<const Header *>(m_data)->height;
+  }
+
+  unsigned MapCache::getGridUnit() const {
+    return reinterpret_cast<const Header *>(m_data)->gridUnit;
+  }
+
+  unsigned MapCache::getGridWidth() const {
+    return reinterpret_cast<const Header *>(m_data)->gridWidth;
+  }
+
+  unsigned MapCache::getGridHeight() const {
+    return reinterpret_cast<const Header *>(m_data)->gridHeight;
+  }
+
+  const MapCache::Layer *MapCache::getLayersBegin() const {
+    auto header = reinterpret_cast<const Header *>(m_data);
+    return getArray<Layer>(header->layerOffset, header->layerCount);
+  }
+
+  const MapCache::Layer *MapCache::getLayersEnd() const {
+    auto header = reinterpret_cast<const Header *>(m_data);
+    return getLayersBegin() + header->layerCount;
+  }
+
+  const char *MapCache::getString(uint32_t index) const {
+    auto header = reinterpret_cast<const Header *>(m_data);
+
+    if (index >= header->stringCount) {
+      return "";
+    }
+
+    auto offsets = getArray<uint32_t>(header->stringOffset, header->stringCount);
+    return m_data + offsets[index];
+  }
+
+  boost::filesystem::path MapCache::getPath(uint32_t index) const {
+    boost::filesystem::path path(getString(index));
+
+    if (path.is_relative()) {
+      return m_base / path;
+    }
+
+    return path;
+  }
+
+  std::size_t MapCache::getGlobalCell() const {
+    return getGridWidth() * getGridHeight();
+  }
+
+  const uint32_t *MapCache::getCells(const Layer& layer) const {
+    assert(layer.type == LayerType::TILE || layer.type == LayerType::SPRITE || layer.type == LayerType::ZONE);
+    return getArray<uint32_t>(layer.index, getGlobalCell() + 2);
+  }
+
+  const Tile *MapCache::getTiles(const Layer& layer) const {
+    assert(layer.type == LayerType::TILE);
+    return getArray<Tile>(layer.offset, layer.count);
+  }
+
+  const MapCache::SpriteRecord *MapCache::getSprites(const Layer& layer) const {
+    assert(layer.type == LayerType::SPRITE);
+    return getArray<SpriteRecord>(layer.offset, layer.count);
+  }
+
+  const MapCache::ZoneRecord *MapCache::getZones(const Layer& layer) const {
+    assert(layer.type == LayerType::ZONE);
+    return getArray<ZoneRecord>(layer.offset, layer.count);
+  }
+
+  const MapCache::PointOfInterestRecord *MapCache::getPointsOfInterest(const Layer& layer) const {
+    assert(layer.type == LayerType::POI);
+    return getArray<PointOfInterestRecord>(layer.offset, layer.count);
+  }
+
+  const MapCache::PointRecord *MapCache::getPoints(const ZoneRecord& zone) const {
+    auto header = reinterpret_cast<const Header *>(m_data);
+    return getArray<PointRecord>(header->pointOffset, header->pointCount) + zone.firstPoint;
+  }
+
+  const game::Id *MapCache::getRequirements(const ZoneRecord& zone) const {
+    auto header = reinterpret_cast<const Header *>(m_data);
+    return getArray<game::Id>(header->requirementOffset, header->requirementCount) + zone.firstRequirement;
+  }
+
+  static constexpr std::size_t PAGE_SIZE = 4096;
+
+  void MapCache::touchCell(std::size_t cell) const {
+    assert(cell <= getGlobalCell());
+    volatile char sink = 0;
+
+    for (auto layer = getLayersBegin(); layer != getLayersEnd(); ++layer) {
+      std::size_t size = 0;
+
+      switch (layer->type) {
+        case LayerType::TILE:
+          size = sizeof(Tile);
+          break;
+        case LayerType::SPRITE:
+          size = sizeof(SpriteRecord);
+          break;
+        case LayerType::ZONE:
+          size = sizeof(ZoneRecord);
+          break;
+        case LayerType::POI:
+          continue;
+      }
+
+      const uint32_t *cells = getCells(*layer);
+      const char *first = m_data + layer->offset + cells[cell] * size;
+      const char *last = m_data + layer->offset + cells[cell + 1] * size;
+
+      for (const char *ptr = first; ptr < last; ptr += PAGE_SIZE) {
+        sink = *ptr;
+      }
+    }
+
+    (void) sink;
+  }
+
+  template<typename T>
+  const T *MapCache::getArray(uint32_t offset, uint32_t count) const {
+    assert(offset % ALIGNMENT == 0);
+    assert(offset + count * sizeof(T) <= m_size);
+    return reinterpret_cast<const T *>(m_data + offset);
+  }
+
+  static bool isInside(std::size_t size, uint32_t offset, std::size_t count, std::size_t elementSize) {
+    return offset % ALIGNMENT == 0 && offset <= size && count <= (size - offset) / elementSize;
+  }
+
+  static bool isValidCells(const char *data, std::size_t size, const MapCache::Layer& layer, std::size_t cellCount) {
+    if (!isInside(size, layer.index, cellCount + 2, sizeof(uint32_t))) {
+      return false;
+    }
+
+    auto cells = reinterpret_cast<const uint32_t *>(data + layer.index);
+    return std::is_sorted(cells, cells + cellCount + 2) && cells[0] == 0 && cells[cellCount + 1] == layer.count;
+  }
+
+  static bool isValidZones(const char *data, const MapCache::Layer& layer, uint32_t pointCount, uint32_t requirementCount) {
+    auto zones = reinterpret_cast<const MapCache::ZoneRecord *>(data + layer.offset);
+
+    for (uint32_t i = 0; i < layer.count; ++i) {
+      const MapCache::ZoneRecord& zone = zones[i];
+
+      if (static_cast<uint64_t>(zone.firstPoint) + zone.pointCount > pointCount) {
+        return false;
+      }
+
+      if (static_cast<uint64_t>(zone.firstRequirement) + zone.requirementCount > requirementCount) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  bool MapCache::setData(const char *data, std::size_t size) {
+    m_data = nullptr;
+    m_size = 0;
+
+    if (size < sizeof(Header)) {
+      return false;
+    }
+
+    auto header = reinterpret_cast<const Header *>(data);
+
+    if (std::memcmp(header->magic, CACHE_MAGIC, sizeof CACHE_MAGIC) != 0 || header->version != VERSION || header->byteOrder != CACHE_BYTE_ORDER) {
+      return false;
+    }
+
+    if (header->gridUnit == 0 || header->gridWidth != computeGridSize(header->width, header->gridUnit) || header->gridHeight != computeGridSize(header->height, header->gridUnit)) {
+      return false;
+    }
+
+    if (!isInside(size, header->layerOffset, header->layerCount, sizeof(Layer))
+        || !isInside(size, header->pointOffset, header->pointCount, sizeof(PointRecord))
+        || !isInside(size, header->requirementOffset, header->requirementCount, sizeof(game::Id))
+        || !isInside(size, header->stringOffset, header->stringCount, sizeof(uint32_t))) {
+      return false;
+    }
+
+    // all the strings are terminated by the end of the file
+    if (header->stringCount > 0 && data[size - 1] != '\0') {
+      return false;
+    }
+
+    auto offsets = reinterpret_cast<const uint32_t *>(data + header->stringOffset);
+
+    for (uint32_t i = 0; i < header->stringCount; ++i) {
+      if (offsets[i] >= size) {
+        return false;
+      }
+    }
+
+    std::size_t cellCount = header->gridWidth * header->gridHeight;
+    auto layers = reinterpret_cast<const Layer *>(data + header->layerOffset);
+
+    for (uint32_t i = 0; i < header->layerCount; ++i) {
+      const Layer& layer = layers[i];
+      bool valid = false;
+
+      switch (layer.type) {
+        case LayerType::TILE:
+          valid = isInside(size, layer.offset, layer.count, sizeof(Tile)) && isValidCells(data, size, layer, cellCount);
+          break;
+        case LayerType::SPRITE:
+          valid = isInside(size, layer.offset, layer.count, sizeof(SpriteRecord)) && isValidCells(data, size, layer, cellCount);
+          break;
+        case LayerType::ZONE:
+          valid = isInside(size, layer.offset, layer.count, sizeof(ZoneRecord)) && isValidCells(data, size, layer, cellCount)
+              && isValidZones(data, layer, header->pointCount, header->requirementCount);
+          break;
+        case LayerType::POI:
+          valid = isInside(size, layer.offset, layer.count, sizeof(PointOfInterestRecord));
+          break;
+      }
+
+      if (!valid) {
+        return false;
+      }
+    }
+
+    m_data = data;
+    m_size = size;
+    return true;
+  }
+
+}
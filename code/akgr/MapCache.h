@@ -0,0 +1,198 @@
+/*
+ * Akagoria, the revenge of Kalista
+ * a single-player RPG in an open world with a top-down view.
+ *
+ * Copyright (c) 2013-2015, Julien Bernard
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef AKGR_MAP_CACHE_H
+#define AKGR_MAP_CACHE_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include <tmx/Map.h>
+
+#include <game/Id.h>
+
+#include "Tile.h"
+
+namespace boost {
+  namespace interprocess {
+    class mapped_region;
+  }
+}
+
+namespace akgr {
+
+  /*
+   * A baked version of the map.
+   *
+   * The cache is a flat binary file that can be mapped in memory and used
+   * as is. Tiles are already transformed into quads, objects are already
+   * classified. Tiles, sprites and zones are sorted by cell of the grid so
+   * that the map can be streamed cell by cell. It can be produced offline
+   * (see akagoria_map_baker) or on the fly from the TMX file.
+   */
+  class MapCache {
+  public:
+    static constexpr uint32_t VERSION = 3;
+    static constexpr unsigned GRID_UNIT = 1600; /* 25 * 64 */
+
+    enum class LayerType : uint32_t {
+      TILE,
+      SPRITE,
+      ZONE,
+      POI,
+    };
+
+    struct Layer {
+      game::Id kind;
+      int32_t floor;
+      LayerType type;
+      uint32_t name;
+      uint32_t texture;
+      uint32_t index;
+      uint32_t offset;
+      uint32_t count;
+    };
+
+    struct SpriteRecord {
+      game::Id id;
+      float angle;
+      float x;
+      float y;
+      int32_t left;
+      int32_t top;
+      int32_t width;
+      int32_t height;
+      uint32_t texture;
+      uint32_t name;
+    };
+
+    enum class ZoneType : uint32_t {
+      EVENT,
+      COLLISION,
+    };
+
+    enum class ZoneShape : uint32_t {
+      RECTANGLE,
+      CHAIN,
+      LOOP,
+    };
+
+    struct ZoneRecord {
+      ZoneType type;
+      ZoneShape shape;
+      uint32_t name;
+      uint32_t event;
+      float x;
+      float y;
+      float width;
+      float height;
+      uint32_t firstPoint;
+      uint32_t pointCount;
+      uint32_t firstRequirement;
+      uint32_t requirementCount;
+    };
+
+    struct PointRecord {
+      float x;
+      float y;
+    };
+
+    struct PointOfInterestRecord {
+      uint32_t name;
+      float x;
+      float y;
+    };
+
+    typedef std::function<void(unsigned, unsigned)> ProgressCallback;
+
+    MapCache();
+    ~MapCache();
+
+    MapCache(const MapCache&) = delete;
+    MapCache& operator=(const MapCache&) = delete;
+
+    /*
+     * The cache is up to date if it is newer than the map, its external
+     * tilesets and their images
+     */
+    static bool isUpToDate(const boost::filesystem::path& cachePath, const boost::filesystem::path& mapPath);
+
+    bool loadFromFile(const boost::filesystem::path& path);
+    void loadFromMap(const tmx::Map& map, const boost::filesystem::path& base, const ProgressCallback& callback = ProgressCallback());
+    bool saveToFile(const boost::filesystem::path& path) const;
+
+    unsigned getWidth() const;
+    unsigned getHeight() const;
+    unsigned getGridUnit() const;
+    unsigned getGridWidth() const;
+    unsigned getGridHeight() const;
+
+    /*
+     * The cell of the objects that do not fit in one cell of the grid
+     */
+    std::size_t getGlobalCell() const;
+
+    const Layer *getLayersBegin() const;
+    const Layer *getLayersEnd() const;
+
+    const char *getString(uint32_t index) const;
+    boost::filesystem::path getPath(uint32_t index) const;
+
+    /*
+     * The objects of the cell i of a tile, sprite or zone layer are in
+     * [cells[i], cells[i + 1]), for i from 0 to getGlobalCell()
+     */
+    const uint32_t *getCells(const Layer& layer) const;
+
+    const Tile *getTiles(const Layer& layer) const;
+    const SpriteRecord *getSprites(const Layer& layer) const;
+    const ZoneRecord *getZones(const Layer& layer) const;
+    const PointOfInterestRecord *getPointsOfInterest(const Layer& layer) const;
+
+    const PointRecord *getPoints(const ZoneRecord& zone) const;
+    const game::Id *getRequirements(const ZoneRecord& zone) const;
+
+    /*
+     * Read the objects of a cell in all the layers, so that they are in
+     * memory when they are needed. It can be called on any thread.
+     */
+    void touchCell(std::size_t cell) const;
+
+  private:
+    bool setData(const char *data, std::size_t size);
+
+    template<typename T>
+    const T *getArray(uint32_t offset, uint32_t count) const;
+
+  private:
+    boost::filesystem::path m_base;
+    std::vector<char> m_buffer;
+    std::unique_ptr<boost::interprocess::mapped_region> m_region;
+    const char *m_data;
+    std::size_t m_size;
+  };
+
+}
+
+#endif // AKGR_MAP_CACHE_H
@@ -56,6 +56,16 @@ namespace akgr {
     static const game::EventType type = "MoveOutsideEvent"_type;
   };
 
+  /*
+   * Something left an event zone, the zone is known by the event that is
+   * triggered when something enters it
+   */
+  struct ZoneExitEvent : public game::Event {
+    static const game::EventType type = "ZoneExitEvent"_type;
+
+    game::EventType zone;
+  };
+
 }
 
 
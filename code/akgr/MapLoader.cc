@@ -0,0 +1,266 @@
+/*
+ * Akagoria, the revenge of Kalista
+ * a single-player RPG in an open world with a top-down view.
+ *
+ * Copyright (c) 2013-2015, Julien Bernard
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "MapLoader.h"
+
+#include <cassert>
+#include <algorithm>
+
+#include <game/Clock.h>
+#include <game/Log.h>
+#include <game/Profiler.h>
+
+namespace akgr {
+
+  MapSink::~MapSink() {
+  }
+
+  void MapSink::beginMap(const MapCache& cache) {
+  }
+
+  void MapSink::loadCell(const MapCache& cache, const MapCache::Layer& layer, std::size_t cell) {
+  }
+
+  void MapSink::unloadCell(std::size_t cell) {
+  }
+
+  void MapSink::endMap(const MapCache& cache) {
+  }
+
+  MapLoader::MapLoader()
+  : m_cache(nullptr)
+  , m_radius(0)
+  {
+  }
+
+  MapLoader::~MapLoader() {
+    for (auto& item : m_pendingCells) {
+      item.second.wait();
+    }
+  }
+
+  void MapLoader::setStreamingRadius(unsigned radius) {
+    m_radius = radius;
+  }
+
+  void MapLoader::addSink(const std::string& kind, MapSink& sink, const std::string& name) {
+    m_dispatch[game::Hash(kind)].push_back(getSinkIndex(sink, name));
+  }
+
+  std::size_t MapLoader::getSinkIndex(MapSink& sink, const std::string& name) {
+    for (std::size_t i = 0; i < m_sinks.size(); ++i) {
+      if (m_sinks[i].sink == &sink) {
+        assert(m_sinks[i].name == name);
+        return i;
+      }
+    }
+
+    m_sinks.push_back({ &sink, name, 0 });
+    return m_sinks.size() - 1;
+  }
+
+  void MapLoader::load(const MapCache& cache, const MapCache::ProgressCallback& callback) {
+    game::ProfileScope scope("MapLoader::load");
+    game::Clock loadingClock;
+    game::Clock clock;
+
+    m_cache = &cache;
+
+    for (auto& data : m_sinks) {
+      game::ProfileScope sinkScope("beginMap", data.name.c_str());
+      clock.restart();
+      data.sink->beginMap(cache);
+      data.elapsed = clock.getElapsedTime().asMicroseconds();
+    }
+
+    // the global cell is always loaded, the other cells only if there is no streaming
+    std::size_t globalCell = cache.getGlobalCell();
+    unsigned layerCount = cache.getLayersEnd() - cache.getLayersBegin();
+    unsigned cellCount = (m_radius == 0) ? globalCell + 1 : 1;
+    unsigned total = layerCount + cellCount;
+    unsigned done = 0;
+
+    for (auto layer = cache.getLayersBegin(); layer != cache.getLayersEnd(); ++layer) {
+      auto it = m_dispatch.find(layer->kind);
+
+      if (it == m_dispatch.end()) {
+        game::Log::warning(game::Log::RESOURCES, "No sink for the layer: '%s'\n", cache.getString(layer->name));
+      } else {
+        game::ProfileScope layerScope("loadLayer", cache.getString(layer->name));
+
+        for (auto index : it->second) {
+          auto& data = m_sinks[index];
+          game::ProfileScope sinkScope(data.name.c_str());
+          clock.restart();
+          data.sink->loadLayer(cache, *layer);
+          data.elapsed += clock.getElapsedTime().asMicroseconds();
+        }
+      }
+
+      if (callback) {
+        callback(++done, total);
+      }
+    }
+
+    loadCell(globalCell);
+
+    if (callback) {
+      callback(++done, total);
+    }
+
+    if (m_radius == 0) {
+      for (std::size_t cell = 0; cell < globalCell; ++cell) {
+        loadCell(cell);
+
+        if (callback) {
+          callback(++done, total);
+        }
+      }
+    }
+
+    for (auto& data : m_sinks) {
+      game::ProfileScope sinkScope("endMap", data.name.c_str());
+      clock.restart();
+      data.sink->endMap(cache);
+      data.elapsed += clock.getElapsedTime().asMicroseconds();
+    }
+
+    game::Log::info(game::Log::RESOURCES, "Map loaded in %.3f s\n", loadingClock.getElapsedTime().asSeconds());
+
+    for (auto& data : m_sinks) {
+      game::Log::info(game::Log::RESOURCES, "\t%s: %.3f s\n", data.name.c_str(), data.elapsed / 1000000.0);
+    }
+  }
+
+  template<typename Func>
+  void MapLoader::processCellsAround(sf::Vector2f pos, Func func) {
+    if (m_cache == nullptr || m_radius == 0) {
+      return;
+    }
+
+    unsigned gridUnit = m_cache->getGridUnit();
+    unsigned gridWidth = m_cache->getGridWidth();
+    unsigned gridHeight = m_cache->getGridHeight();
+
+    unsigned x = std::min(static_cast<unsigned>(std::max(pos.x, 0.0f) / gridUnit), gridWidth - 1);
+    unsigned y = std::min(static_cast<unsigned>(std::max(pos.y, 0.0f) / gridUnit), gridHeight - 1);
+
+    unloadFarCells(x, y);
+
+    unsigned xmin = (x > m_radius) ? x - m_radius : 0;
+    unsigned xmax = std::min(x + m_radius, gridWidth - 1);
+    unsigned ymin = (y > m_radius) ? y - m_radius : 0;
+    unsigned ymax = std::min(y + m_radius, gridHeight - 1);
+
+    for (unsigned j = ymin; j <= ymax; ++j) {
+      for (unsigned i = xmin; i <= xmax; ++i) {
+        func(j * gridWidth + i);
+      }
+    }
+  }
+
+  void MapLoader::loadCellsAround(sf::Vector2f pos) {
+    processCellsAround(pos, [this](std::size_t cell) {
+      if (m_loadedCells.count(cell) > 0) {
+        return;
+      }
+
+      auto it = m_pendingCells.find(cell);
+
+      if (it != m_pendingCells.end()) {
+        it->second.get();
+        m_pendingCells.erase(it);
+      }
+
+      loadCell(cell);
+    });
+  }
+
+  void MapLoader::requestCellsAround(sf::Vector2f pos) {
+    // load the cells that have been read
+    for (auto it = m_pendingCells.begin(); it != m_pendingCells.end(); ) {
+      if (it->second.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        it->second.get();
+        loadCell(it->first);
+        it = m_pendingCells.erase(it);
+      } else {
+        ++it;
+      }
+    }
+
+    // read the new cells in the background
+    processCellsAround(pos, [this](std::size_t cell) {
+      if (m_loadedCells.count(cell) > 0 || m_pendingCells.count(cell) > 0) {
+        return;
+      }
+
+      const MapCache *cache = m_cache;
+      m_pendingCells.emplace(cell, std::async(std::launch::async, [cache, cell]() {
+        cache->touchCell(cell);
+      }));
+    });
+  }
+
+  void MapLoader::loadCell(std::size_t cell) {
+    assert(m_cache);
+    game::ProfileScope scope("MapLoader::loadCell");
+
+    for (auto layer = m_cache->getLayersBegin(); layer != m_cache->getLayersEnd(); ++layer) {
+      auto it = m_dispatch.find(layer->kind);
+
+      if (it == m_dispatch.end()) {
+        continue;
+      }
+
+      for (auto index : it->second) {
+        m_sinks[index].sink->loadCell(*m_cache, *layer, cell);
+      }
+    }
+
+    m_loadedCells.insert(cell);
+  }
+
+  void MapLoader::unloadFarCells(unsigned x, unsigned y) {
+    std::size_t globalCell = m_cache->getGlobalCell();
+    unsigned gridWidth = m_cache->getGridWidth();
+
+    // one more cell than the radius, not to unload and load again at the border
+    unsigned limit = m_radius + 1;
+
+    for (auto it = m_loadedCells.begin(); it != m_loadedCells.end(); ) {
+      std::size_t cell = *it;
+      unsigned cx = cell % gridWidth;
+      unsigned cy = cell / gridWidth;
+
+      if (cell == globalCell || (std::max(cx, x) - std::min(cx, x) <= limit && std::max(cy, y) - std::min(cy, y) <= limit)) {
+        ++it;
+        continue;
+      }
+
+      game::ProfileScope scope("MapLoader::unloadCell");
+
+      for (auto& data : m_sinks) {
+        data.sink->unloadCell(cell);
+      }
+
+      it = m_loadedCells.erase(it);
+    }
+  }
+
+}
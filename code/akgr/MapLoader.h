@@ -0,0 +1,114 @@
+/*
+ * Akagoria, the revenge of Kalista
+ * a single-player RPG in an open world with a top-down view.
+ *
+ * Copyright (c) 2013-2015, Julien Bernard
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef AKGR_MAP_LOADER_H
+#define AKGR_MAP_LOADER_H
+
+#include <cstdint>
+#include <future>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <SFML/System.hpp>
+
+#include <game/Id.h>
+
+#include "MapCache.h"
+
+namespace akgr {
+
+  /*
+   * A consumer of the layers of the map.
+   *
+   * A layer is announced with loadLayer(), then its objects are given cell
+   * by cell with loadCell(). A cell may be unloaded and loaded again later.
+   */
+  class MapSink {
+  public:
+    virtual ~MapSink();
+
+    virtual void beginMap(const MapCache& cache);
+    virtual void loadLayer(const MapCache& cache, const MapCache::Layer& layer) = 0;
+    virtual void loadCell(const MapCache& cache, const MapCache::Layer& layer, std::size_t cell);
+    virtual void unloadCell(std::size_t cell);
+    virtual void endMap(const MapCache& cache);
+  };
+
+  /*
+   * The map ingestion pipeline.
+   *
+   * The layers are visited once and each one is dispatched to the sinks
+   * registered for its kind. Then the cells are loaded, either all at once,
+   * or streamed around the hero if a streaming radius is set.
+   */
+  class MapLoader {
+  public:
+    MapLoader();
+    ~MapLoader();
+
+    void addSink(const std::string& kind, MapSink& sink, const std::string& name);
+
+    /*
+     * The cells at more than the radius from the focus cell are not loaded,
+     * 0 means that all the cells are loaded
+     */
+    void setStreamingRadius(unsigned radius);
+
+    void load(const MapCache& cache, const MapCache::ProgressCallback& callback = MapCache::ProgressCallback());
+
+    /*
+     * Load the cells around the position now
+     */
+    void loadCellsAround(sf::Vector2f pos);
+
+    /*
+     * Read the cells around the position in the background and load them
+     * when they are ready, unload the cells that are too far
+     */
+    void requestCellsAround(sf::Vector2f pos);
+
+  private:
+    struct SinkData {
+      MapSink *sink;
+      std::string name;
+      int64_t elapsed;
+    };
+
+    std::size_t getSinkIndex(MapSink& sink, const std::string& name);
+
+    void loadCell(std::size_t cell);
+    void unloadFarCells(unsigned x, unsigned y);
+
+    template<typename Func>
+    void processCellsAround(sf::Vector2f pos, Func func);
+
+  private:
+    std::vector<SinkData> m_sinks;
+    std::map<game::Id, std::vector<std::size_t>> m_dispatch;
+    const MapCache *m_cache;
+    unsigned m_radius;
+    std::set<std::size_t> m_loadedCells;
+    std::map<std::size_t, std::future<void>> m_pendingCells;
+  };
+
+}
+
+#endif // AKGR_MAP_LOADER_H
@@ -48,14 +48,14 @@ namespace akgr {
     }
   }
 
-  void MessageManager::render(sf::RenderWindow& window)  {
+  void MessageManager::render(game::RenderQueue& queue)  {
     if (m_items.empty()) {
       return;
     }
 
     auto& currentItem = m_items.front();
     m_ui.setMessage(*currentItem.data);
-    m_ui.render(window);
+    m_ui.render(queue);
   }
 
 }
@@ -35,7 +35,7 @@ namespace akgr {
     void postMessage(const std::string& name, float time);
 
     virtual void update(float dt) override;
-    virtual void render(sf::RenderWindow& window) override;
+    virtual void render(game::RenderQueue& queue) override;
 
   private:
     struct MessageItem {
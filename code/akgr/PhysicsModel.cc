@@ -20,17 +20,17 @@
 #include "PhysicsModel.h"
 
 #include <algorithm>
-#include <iterator>
-
-#include <boost/algorithm/string/split.hpp>
-#include <boost/algorithm/string/classification.hpp> // for is_any_of
-
-#include <tmx/Object.h>
-#include <tmx/ObjectLayer.h>
+#include <cmath>
+#include <cstdlib>
 
 #include <game/Event.h>
 #include <game/Log.h>
+#include <game/Profiler.h>
 
+#include "DataManager.h"
+#include "GameEvents.h"
+#include "MapCache.h"
+#include "MapEvents.h"
 #include "RequirementManager.h"
 #include "Singletons.h"
 
@@ -101,7 +101,11 @@ namespace akgr {
     return fixture;
   }
 
-  static b2Fixture *createCircleFixture(b2Body *body, int floor, bool isSolid, bool isSensor, float radius) {
+  /*
+   * the center of the circle and the rectangle are in the body coordinates
+   */
+
+  static b2Fixture *createCircleFixture(b2Body *body, int floor, bool isSolid, bool isSensor, float radius, b2Vec2 center) {
     assert(body);
 
     auto fixture = createFixture(floor, isSolid, isSensor);
@@ -109,18 +113,19 @@ namespace akgr {
     b2CircleShape shape;
     fixture.shape = &shape;
     shape.m_radius = radius * PhysicsModel::BOX2D_SCALE;
+    shape.m_p = center;
 
     return body->CreateFixture(&fixture);
   }
 
-  static b2Fixture *createRectangleFixture(b2Body *body, int floor, bool isSolid, bool isSensor, float width, float height) {
+  static b2Fixture *createRectangleFixture(b2Body *body, int floor, bool isSolid, bool isSensor, float width, float height, b2Vec2 center) {
     assert(body);
 
     auto fixture = createFixture(floor, isSolid, isSensor);
 
     b2PolygonShape shape;
     fixture.shape = &shape;
-    shape.SetAsBox(width  * PhysicsModel::BOX2D_SCALE * 0.5f, height * PhysicsModel::BOX2D_SCALE * 0.5f);
+    shape.SetAsBox(width  * PhysicsModel::BOX2D_SCALE * 0.5f, height * PhysicsModel::BOX2D_SCALE * 0.5f, center, 0.0f);
 
     return body->CreateFixture(&fixture);
   }
@@ -142,196 +147,466 @@ namespace akgr {
     return body->CreateFixture(&fixture);
   }
 
-  static b2Fixture *createFixtureFromObject(b2World& world, const tmx::Object *object, int floor, bool isSensor) {
-    if (object->isRectangle()) {
-      auto rectangleObject = static_cast<const tmx::Rectangle*>(object);
+  // the body of the zone is the static body of its cell, at the origin of the world
+  static b2Fixture *createFixtureFromZone(b2Body *body, const MapCache& cache, const MapCache::ZoneRecord& zone, int floor, bool isSensor) {
+    switch (zone.shape) {
+      case MapCache::ZoneShape::RECTANGLE: {
+        float x = zone.x + zone.width * 0.5f;
+        float y = zone.y + zone.height * 0.5f;
+        b2Vec2 center(x * PhysicsModel::BOX2D_SCALE, y * PhysicsModel::BOX2D_SCALE);
 
-      float x = rectangleObject->getX();
-      float y = rectangleObject->getY();
-      float width = rectangleObject->getWidth();
-      float height = rectangleObject->getHeight();
+        return createRectangleFixture(body, floor, true, isSensor, zone.width, zone.height, center);
+      }
 
-      x += width * 0.5f;
-      y += height * 0.5f;
+      case MapCache::ZoneShape::CHAIN:
+      case MapCache::ZoneShape::LOOP: {
+        const MapCache::PointRecord *points = cache.getPoints(zone);
+        std::vector<b2Vec2> chain;
 
-      b2BodyDef def;
-      def.type = b2_staticBody;
-      def.position = { x * PhysicsModel::BOX2D_SCALE, y * PhysicsModel::BOX2D_SCALE };
-      auto body = world.CreateBody(&def);
+        for (uint32_t i = 0; i < zone.pointCount; ++i) {
+          chain.emplace_back((zone.x + points[i].x) * PhysicsModel::BOX2D_SCALE, (zone.y + points[i].y) * PhysicsModel::BOX2D_SCALE);
+        }
 
-      return createRectangleFixture(body, floor, true, isSensor, width, height);
+        return createChainFixture(body, floor, true, isSensor, chain, zone.shape == MapCache::ZoneShape::LOOP);
+      }
     }
 
-    if (object->isChain()) {
-      auto chainObject = static_cast<const tmx::Chain *>(object);
+    return nullptr;
+  }
+
+  /*
+   * Collision baking
+   *
+   * The collision rectangles of a cell that touch each other are merged:
+   * their union is traced as chain loops, so that there are no inner edges
+   * and no seams between the rectangles. A rectangle that touches no other
+   * rectangle stays a box.
+   *
+   * The coordinates are snapped to whole pixels first, so that two sides
+   * that almost coincide become the same grid line, and the vertices of the
+   * chains are never closer than the linear slop of Box2D.
+   */
+
+  struct CollisionRectangle {
+    float left;
+    float top;
+    float right;
+    float bottom;
+  };
 
-      float x = chainObject->getX();
-      float y = chainObject->getY();
+  // the rectangles overlap or share a part of a side, not just a corner
+  static bool areTouching(const CollisionRectangle& lhs, const CollisionRectangle& rhs) {
+    float width = std::min(lhs.right, rhs.right) - std::max(lhs.left, rhs.left);
+    float height = std::min(lhs.bottom, rhs.bottom) - std::max(lhs.top, rhs.top);
+    return width >= 0.0f && height >= 0.0f && (width > 0.0f || height > 0.0f);
+  }
 
-      std::vector<b2Vec2> chain;
+  static std::vector<std::vector<CollisionRectangle>> computeTouchingGroups(const std::vector<CollisionRectangle>& rectangles) {
+    std::vector<std::size_t> groupOf(rectangles.size(), rectangles.size());
+    std::vector<std::vector<CollisionRectangle>> groups;
 
-      for (auto point : *chainObject) {
-        chain.emplace_back(point.x * PhysicsModel::BOX2D_SCALE, point.y * PhysicsModel::BOX2D_SCALE);
+    for (std::size_t i = 0; i < rectangles.size(); ++i) {
+      if (groupOf[i] != rectangles.size()) {
+        continue;
       }
 
-      b2BodyDef def;
-      def.type = b2_staticBody;
-      def.position = { x * PhysicsModel::BOX2D_SCALE, y * PhysicsModel::BOX2D_SCALE };
-      auto body = world.CreateBody(&def);
+      std::size_t group = groups.size();
+      groups.emplace_back();
+
+      std::vector<std::size_t> stack = { i };
+      groupOf[i] = group;
 
-      return createChainFixture(body, floor, true, isSensor, chain, object->isPolygon());
+      while (!stack.empty()) {
+        std::size_t current = stack.back();
+        stack.pop_back();
+        groups[group].push_back(rectangles[current]);
+
+        for (std::size_t j = 0; j < rectangles.size(); ++j) {
+          if (groupOf[j] == rectangles.size() && areTouching(rectangles[current], rectangles[j])) {
+            groupOf[j] = group;
+            stack.push_back(j);
+          }
+        }
+      }
     }
 
-    return nullptr;
+    return groups;
   }
 
+  static std::vector<float> computeCoordinates(std::vector<float> coords) {
+    std::sort(coords.begin(), coords.end());
+    coords.erase(std::unique(coords.begin(), coords.end()), coords.end());
+    return coords;
+  }
 
-  class PhysicsListener : public b2ContactListener {
-  public:
-    void addEventZone(int floor, const std::string& name, const tmx::Object *object, const std::string& id, std::vector<std::string> requirementList) {
-      auto fixture = createFixtureFromObject(gPhysicsModel().getWorld(), object, floor, true);
+  static std::size_t findCoordinate(const std::vector<float>& coords, float value) {
+    auto it = std::lower_bound(coords.begin(), coords.end(), value);
+    assert(it != coords.end() && *it == value);
+    return it - coords.begin();
+  }
 
-      if (fixture == nullptr) {
-        game::Log::warning(game::Log::PHYSICS, "An event zone could not be transformed into a fixture: '%s'\n", name.c_str());
-        return;
-      }
+  /*
+   * The union is computed on the grid of the coordinates of the rectangles.
+   * The sides of the covered grid cells that are next to an uncovered grid
+   * cell are the edges of the outline, they are oriented with the inside on
+   * their right and then linked into loops.
+   */
+  static std::vector<std::vector<b2Vec2>> computeOutlines(const std::vector<CollisionRectangle>& rectangles) {
+    std::vector<float> xs;
+    std::vector<float> ys;
+
+    for (auto& rectangle : rectangles) {
+      xs.push_back(rectangle.left);
+      xs.push_back(rectangle.right);
+      ys.push_back(rectangle.top);
+      ys.push_back(rectangle.bottom);
+    }
 
-      auto eventType = game::Hash(id);
-      std::vector<game::Id> requirementIds;
-      std::transform(requirementList.begin(), requirementList.end(), std::back_inserter(requirementIds), [](const std::string& str) {
-        return game::Hash(str);
-      });
+    xs = computeCoordinates(std::move(xs));
+    ys = computeCoordinates(std::move(ys));
 
-      m_eventZones[fixture] = Zone{ eventType, std::move(requirementIds) };
-      m_eventNames[eventType] = id;
-    }
+    std::size_t width = xs.size() - 1;
+    std::size_t height = ys.size() - 1;
+    std::vector<bool> covered(width * height, false);
 
-    void addCollisionZone(int floor, const std::string& name, const tmx::Object *object) {
-      auto fixture = createFixtureFromObject(gPhysicsModel().getWorld(), object, floor, false);
+    for (auto& rectangle : rectangles) {
+      std::size_t left = findCoordinate(xs, rectangle.left);
+      std::size_t right = findCoordinate(xs, rectangle.right);
+      std::size_t top = findCoordinate(ys, rectangle.top);
+      std::size_t bottom = findCoordinate(ys, rectangle.bottom);
 
-      if (fixture == nullptr) {
-        game::Log::warning(game::Log::PHYSICS, "A collision zone could not be transformed into a fixture: '%s'\n", name.c_str());
-        return;
+      for (std::size_t j = top; j < bottom; ++j) {
+        for (std::size_t i = left; i < right; ++i) {
+          covered[j * width + i] = true;
+        }
       }
     }
 
-    virtual void BeginContact(b2Contact* contact) override {
-      b2Fixture* fixtureA = contact->GetFixtureA();
-      b2Fixture* fixtureB = contact->GetFixtureB();
+    auto isCovered = [&covered, width, height](std::size_t i, std::size_t j) {
+      // out of the grid, the indices wrap and are too big
+      return i < width && j < height && covered[j * width + i];
+    };
+
+    // the vertices are indexed on the grid of the coordinates
+    std::size_t stride = xs.size();
+    std::multimap<std::size_t, std::size_t> edges;
+
+    for (std::size_t j = 0; j < height; ++j) {
+      for (std::size_t i = 0; i < width; ++i) {
+        if (!isCovered(i, j)) {
+          continue;
+        }
+
+        std::size_t topLeft = j * stride + i;
+        std::size_t topRight = topLeft + 1;
+        std::size_t bottomLeft = topLeft + stride;
+        std::size_t bottomRight = bottomLeft + 1;
+
+        if (!isCovered(i, j - 1)) {
+          edges.emplace(topLeft, topRight);
+        }
+
+        if (!isCovered(i + 1, j)) {
+          edges.emplace(topRight, bottomRight);
+        }
+
+        if (!isCovered(i, j + 1)) {
+          edges.emplace(bottomRight, bottomLeft);
+        }
 
-      triggerZoneEvent(fixtureB, fixtureA) || triggerZoneEvent(fixtureA, fixtureB);
+        if (!isCovered(i - 1, j)) {
+          edges.emplace(bottomLeft, topLeft);
+        }
+      }
     }
 
-    bool triggerZoneEvent(b2Fixture *fixtureZone, b2Fixture *fixtureOther) {
-      auto event = findEvent(fixtureZone);
+    auto direction = [stride](std::size_t from, std::size_t to) {
+      int dx = static_cast<int>(to % stride) - static_cast<int>(from % stride);
+      int dy = static_cast<int>(to / stride) - static_cast<int>(from / stride);
+      return sf::Vector2i(dx, dy);
+    };
+
+    auto cross = [](sf::Vector2i lhs, sf::Vector2i rhs) {
+      return lhs.x * rhs.y - lhs.y * rhs.x;
+    };
+
+    std::vector<std::vector<b2Vec2>> outlines;
+
+    while (!edges.empty()) {
+      std::vector<std::size_t> loop;
 
-      if (event == INVALID_EVENT) {
-        return false;
+      auto edge = edges.begin();
+      std::size_t start = edge->first;
+      std::size_t previous = start;
+      std::size_t current = edge->second;
+      edges.erase(edge);
+      loop.push_back(start);
+
+      while (current != start) {
+        loop.push_back(current);
+
+        // when two loops meet at a corner, turn right to stay on the same loop
+        auto range = edges.equal_range(current);
+        assert(range.first != range.second);
+        auto incoming = direction(previous, current);
+        auto next = range.first;
+
+        for (auto it = range.first; it != range.second; ++it) {
+          if (cross(incoming, direction(current, it->second)) > cross(incoming, direction(current, next->second))) {
+            next = it;
+          }
+        }
+
+        previous = current;
+        current = next->second;
+        edges.erase(next);
+      }
+
+      // only the corners are kept
+      std::vector<b2Vec2> outline;
+
+      for (std::size_t k = 0; k < loop.size(); ++k) {
+        std::size_t before = loop[(k + loop.size() - 1) % loop.size()];
+        std::size_t vertex = loop[k];
+        std::size_t after = loop[(k + 1) % loop.size()];
+
+        if (cross(direction(before, vertex), direction(vertex, after)) == 0) {
+          continue;
+        }
+
+        float x = xs[vertex % stride];
+        float y = ys[vertex / stride];
+        outline.emplace_back(x * PhysicsModel::BOX2D_SCALE, y * PhysicsModel::BOX2D_SCALE);
+      }
+
+      // a vertex too close to the previous one would make an invalid chain
+      std::vector<b2Vec2> vertices;
+
+      for (auto& vertex : outline) {
+        if (vertices.empty() || b2DistanceSquared(vertices.back(), vertex) > b2_linearSlop * b2_linearSlop) {
+          vertices.push_back(vertex);
+        }
+      }
+
+      while (vertices.size() > 1 && b2DistanceSquared(vertices.back(), vertices.front()) <= b2_linearSlop * b2_linearSlop) {
+        vertices.pop_back();
       }
 
-      gEventManager().triggerEvent(event, nullptr);
-      game::Log::info(game::Log::PHYSICS, "Map event triggered: %s (%" PRIu64 ")\n", m_eventNames[event].c_str(), event);
-      return true;
+      if (vertices.size() >= 3) {
+        outlines.push_back(std::move(vertices));
+      }
     }
 
-    game::EventType findEvent(b2Fixture *fixture) {
-      auto it = m_eventZones.find(fixture);
+    return outlines;
+  }
+
+  static void createBakedFixtures(b2Body *body, int floor, const std::vector<CollisionRectangle>& rectangles) {
+    std::vector<CollisionRectangle> snapped;
 
-      if (it == m_eventZones.end()) {
-        return INVALID_EVENT;
+    for (auto& rectangle : rectangles) {
+      CollisionRectangle pixels{ std::round(rectangle.left), std::round(rectangle.top), std::round(rectangle.right), std::round(rectangle.bottom) };
+
+      // a rectangle thinner than half a pixel has no area left
+      if (pixels.left < pixels.right && pixels.top < pixels.bottom) {
+        snapped.push_back(pixels);
       }
+    }
 
-      const Zone& zone = it->second;
+    for (auto& group : computeTouchingGroups(snapped)) {
+      assert(!group.empty());
 
-      if (!gRequirementManager().hasRequirements(zone.requirements.begin(), zone.requirements.end())) {
-        return INVALID_EVENT;
+      if (group.size() == 1) {
+        auto& rectangle = group.front();
+        float width = rectangle.right - rectangle.left;
+        float height = rectangle.bottom - rectangle.top;
+        b2Vec2 center((rectangle.left + rectangle.right) * 0.5f * PhysicsModel::BOX2D_SCALE, (rectangle.top + rectangle.bottom) * 0.5f * PhysicsModel::BOX2D_SCALE);
+        createRectangleFixture(body, floor, true, false, width, height, center);
+        continue;
       }
 
-      return zone.type;
+      for (auto& outline : computeOutlines(group)) {
+        createChainFixture(body, floor, true, false, outline, true);
+      }
     }
+  }
 
-  private:
-    struct Zone {
-      game::EventType type;
-      std::vector<game::Id> requirements;
-    };
 
-    std::map<b2Fixture*, Zone> m_eventZones;
-    std::map<game::EventType, std::string> m_eventNames;
-  };
+  class PhysicsListener : public b2ContactListener {
+  public:
+    b2Fixture *addEventZone(b2Body *body, int floor, const MapCache& cache, const MapCache::ZoneRecord& zone) {
+      auto fixture = createFixtureFromZone(body, cache, zone, floor, true);
 
-  namespace {
-    struct ZoneConstructor : public tmx::LayerVisitor {
-      ZoneConstructor(PhysicsListener& listener)
-      : m_listener(listener)
-      {
+      if (fixture == nullptr) {
+        game::Log::warning(game::Log::PHYSICS, "An event zone could not be transformed into a fixture: '%s'\n", cache.getString(zone.name));
+        return nullptr;
+      }
 
+      std::string id = cache.getString(zone.event);
+      auto eventType = game::Hash(id);
+      const game::Id *requirements = cache.getRequirements(zone);
+
+      Zone data;
+      data.type = eventType;
+      data.requirements = gRequirementManager().compileRequirements(requirements, requirements + zone.requirementCount);
+      data.hitSteps[Hit::ENTER] = data.hitSteps[Hit::EXIT] = 0;
+
+      std::size_t index;
+
+      if (m_freeZones.empty()) {
+        index = m_zones.size();
+        data.generation = 0;
+        m_zones.push_back(data);
+      } else {
+        index = m_freeZones.back();
+        m_freeZones.pop_back();
+        data.generation = m_zones[index].generation;
+        m_zones[index] = data;
       }
 
-      virtual void visitObjectLayer(const tmx::Map& map, const tmx::ObjectLayer& layer) override {
-        if (!layer.hasProperty("kind")) {
-          game::Log::warning(game::Log::PHYSICS, "No kind for the layer: '%s'\n", layer.getName().c_str());
-          return;
-        }
+      // 0 is for the fixtures that are not event zones
+      fixture->SetUserData(reinterpret_cast<void*>(static_cast<uintptr_t>(index + 1)));
+      m_eventNames[eventType] = std::move(id);
+      return fixture;
+    }
 
-        if (layer.getProperty("kind", "") != "zone") {
-          return;
-        }
+    b2Fixture *addCollisionZone(b2Body *body, int floor, const MapCache& cache, const MapCache::ZoneRecord& zone) {
+      auto fixture = createFixtureFromZone(body, cache, zone, floor, false);
 
-        int floor = std::stoi(layer.getProperty("floor", "0"));
+      if (fixture == nullptr) {
+        game::Log::warning(game::Log::PHYSICS, "A collision zone could not be transformed into a fixture: '%s'\n", cache.getString(zone.name));
+        return nullptr;
+      }
 
-        game::Log::info(game::Log::PHYSICS, "Loading zone layer: '%s' (floor: %i)\n", layer.getName().c_str(), floor);
+      return fixture;
+    }
 
-        unsigned eventCount = 0;
-        unsigned collisionCount = 0;
+    void removeZones(b2Body *body) {
+      for (b2Fixture *fixture = body->GetFixtureList(); fixture != nullptr; fixture = fixture->GetNext()) {
+        auto data = reinterpret_cast<uintptr_t>(fixture->GetUserData());
 
-        for (auto obj : layer) {
-          const std::string& name = obj->getName();
+        if (data != 0) {
+          std::size_t zone = data - 1;
+          // the hits that are still pending for this zone are now stale
+          m_zones[zone].generation++;
+          m_freeZones.push_back(zone);
+          fixture->SetUserData(nullptr);
+        }
+      }
+    }
 
-          if (obj->getType() == "event") {
-            if (!obj->hasProperty("id")) {
-              game::Log::warning(game::Log::PHYSICS, "No event id for the object: '%s'\n", name.c_str());
-              continue;
-            }
+    /*
+     * The contacts happen in the middle of the step, when the world is
+     * locked. They are only recorded, and the events are triggered after
+     * the step, when the handlers can change the world.
+     */
 
-            const std::string& id = obj->getProperty("id", "");
+    virtual void BeginContact(b2Contact* contact) override {
+      recordZoneHit(contact, Hit::ENTER);
+    }
 
-            std::string requirements = obj->getProperty("requirements", "");
-            std::vector<std::string> requirementList;
-            boost::algorithm::split(requirementList, requirements, boost::algorithm::is_any_of(", "), boost::algorithm::token_compress_on);
+    virtual void EndContact(b2Contact* contact) override {
+      recordZoneHit(contact, Hit::EXIT);
+    }
 
-            requirementList.erase(std::remove_if(requirementList.begin(), requirementList.end(), [](const std::string& req) {
-              return req.empty();
-            }), requirementList.end());
+    void dispatchZoneHits() {
+      // the handlers may record new hits
+      std::vector<Hit> hits;
+      std::swap(hits, m_hits);
+      m_step++;
 
-            m_listener.addEventZone(floor, name, obj, id, std::move(requirementList));
-            eventCount++;
-          } else if (obj->getType() == "collision") {
-            m_listener.addCollisionZone(floor, name, obj);
-            collisionCount++;
-          } else {
-            game::Log::warning(game::Log::PHYSICS, "No type for the object: '%s'\n", name.c_str());
+      for (auto& hit : hits) {
+        assert(hit.zone < m_zones.size());
+        const Zone& zone = m_zones[hit.zone];
+
+        // the zone has been removed since the hit, maybe by a handler
+        if (zone.generation != hit.generation) {
+          continue;
+        }
+
+        switch (hit.kind) {
+          case Hit::ENTER: {
+            if (!gRequirementManager().hasRequirements(zone.requirements)) {
+              break;
+            }
+
+            // the handler may add zones and move the table
+            game::EventType type = zone.type;
+            gEventManager().triggerEvent(type, nullptr);
+            game::Log::info(game::Log::PHYSICS, "Map event triggered: %s (%" PRIu64 ")\n", m_eventNames[type].c_str(), type);
+            break;
           }
 
+          case Hit::EXIT: {
+            ZoneExitEvent event;
+            event.zone = zone.type;
+            gEventManager().triggerEvent(&event);
+            break;
+          }
         }
+      }
+    }
+
+  private:
+    struct Hit {
+      enum Kind {
+        ENTER,
+        EXIT,
+      };
+
+      std::size_t zone;
+      unsigned generation;
+      Kind kind;
+    };
+
+    void recordZoneHit(b2Contact *contact, Hit::Kind kind) {
+      auto data = reinterpret_cast<uintptr_t>(contact->GetFixtureB()->GetUserData());
+
+      if (data == 0) {
+        data = reinterpret_cast<uintptr_t>(contact->GetFixtureA()->GetUserData());
+      }
 
-        game::Log::info(game::Log::PHYSICS, "\tObjects loaded: %u event zones and %u collision zones\n", eventCount, collisionCount);
+      if (data == 0) {
+        return;
       }
-    private:
-      PhysicsListener& m_listener;
+
+      // a zone is hit once per step, whatever the number of touching fixtures
+      std::size_t zone = data - 1;
+      assert(zone < m_zones.size());
+      Zone& hitZone = m_zones[zone];
+
+      if (hitZone.hitSteps[kind] == m_step) {
+        return;
+      }
+
+      hitZone.hitSteps[kind] = m_step;
+      m_hits.push_back({ zone, hitZone.generation, kind });
+    }
+
+  private:
+    struct Zone {
+      game::EventType type;
+      RequirementManager::RequirementSet requirements;
+      unsigned generation;
+      unsigned hitSteps[2]; // the last step with a hit of each kind
     };
 
-  }
+    // the index of the zone is in the user data of its fixture
+    std::vector<Zone> m_zones;
+    std::vector<std::size_t> m_freeZones;
+    std::map<game::EventType, std::string> m_eventNames;
+    std::vector<Hit> m_hits;
+    unsigned m_step = 1; // the step whose hits are recorded, the zones start at 0
+  };
 
-  static void addFixtureToBody(b2Body *body, int floor, bool isSolid, bool isSensor, const CollisionData *data) {
+  static void addFixtureToBody(b2Body *body, int floor, bool isSolid, bool isSensor, const CollisionData *data, b2Vec2 center = b2Vec2(0.0f, 0.0f)) {
     assert(data);
 
     switch (data->shape) {
       case CollisionShape::CIRCLE:
-        createCircleFixture(body, floor, isSolid, isSensor, data->circle.radius);
+        createCircleFixture(body, floor, isSolid, isSensor, data->circle.radius, center);
         break;
       case CollisionShape::RECTANGLE:
-        createRectangleFixture(body, floor, isSolid, isSensor, data->rectangle.width, data->rectangle.height);
+        createRectangleFixture(body, floor, isSolid, isSensor, data->rectangle.width, data->rectangle.height, center);
         break;
       default:
         game::Log::warning(game::Log::PHYSICS, "Unknown collision data shape\n");
@@ -346,33 +621,100 @@ namespace akgr {
   PhysicsModel::PhysicsModel()
   : m_world({ 0.0f, 0.0f })
   , m_listener(nullptr)
+  , m_alpha(1.0f)
+  , m_gridUnit(0)
+  , m_activityRadius(0)
+  , m_activityDirty(true)
+  , m_focusX(0)
+  , m_focusY(0)
+  , m_focusFloor(0)
   {
-
+    gEventManager().registerHandler<HeroLocationEvent>(&PhysicsModel::onHeroLocation, this);
   }
 
   PhysicsModel::~PhysicsModel() {
+    for (b2Body *body = m_world.GetBodyList(); body != nullptr; body = body->GetNext()) {
+      delete static_cast<Transform*>(body->GetUserData());
+    }
+
     delete m_listener;
   }
 
   void PhysicsModel::update(float dt) {
+    // the transforms of the moving bodies before the step, for the interpolation
+    for (b2Body *body = m_world.GetBodyList(); body != nullptr; body = body->GetNext()) {
+      auto previous = static_cast<Transform*>(body->GetUserData());
+
+      if (previous != nullptr) {
+        previous->position = body->GetPosition();
+        previous->angle = body->GetAngle();
+      }
+    }
+
     int32 velocityIterations = 10; // 6;
     int32 positionIterations = 8; // 2;
     m_world.Step(dt, velocityIterations, positionIterations);
+
+    if (m_listener != nullptr) {
+      m_listener->dispatchZoneHits();
+    }
   }
 
-  void PhysicsModel::addMapItem(const Location& loc, const CollisionData *data) {
-    b2BodyDef def;
-    def.type = b2_staticBody;
-    def.position = { loc.pos.x * BOX2D_SCALE, loc.pos.y * BOX2D_SCALE };
+  void PhysicsModel::interpolate(float alpha) {
+    m_alpha = alpha;
+  }
+
+  b2Vec2 PhysicsModel::getInterpolatedPosition(const b2Body *body) const {
+    auto previous = static_cast<const Transform*>(body->GetUserData());
+
+    if (previous == nullptr) {
+      return body->GetPosition();
+    }
+
+    return (1.0f - m_alpha) * previous->position + m_alpha * body->GetPosition();
+  }
+
+  float PhysicsModel::getInterpolatedAngle(const b2Body *body) const {
+    auto previous = static_cast<const Transform*>(body->GetUserData());
+
+    if (previous == nullptr) {
+      return body->GetAngle();
+    }
+
+    /* the angle may have been reset to the other side of the circle */
+    float delta = std::remainder(body->GetAngle() - previous->angle, 2 * b2_pi);
+    return previous->angle + m_alpha * delta;
+  }
+
+  void PhysicsModel::addMapItem(const Location& loc, const CollisionData *data, std::size_t cell) {
+    b2Vec2 center(loc.pos.x * BOX2D_SCALE, loc.pos.y * BOX2D_SCALE);
+    addFixtureToBody(getCellBody(cell, loc.floor), loc.floor, true, false, data, center);
+  }
+
+  b2Body *PhysicsModel::getCellBody(std::size_t cell, int floor) {
+    b2Body *& body = m_cellBodies[cell][floor];
+
+    if (body == nullptr) {
+      b2BodyDef def;
+      def.type = b2_staticBody;
+      def.position = { 0.0f, 0.0f };
+      body = m_world.CreateBody(&def);
+    }
+
+    return body;
+  }
+
+  b2Body *PhysicsModel::createMovingBody(const b2BodyDef& def) {
     auto body = m_world.CreateBody(&def);
-    addFixtureToBody(body, loc.floor, true, false, data);
+    body->SetUserData(new Transform{ body->GetPosition(), body->GetAngle() });
+    return body;
   }
 
   Body PhysicsModel::createHeroBody(const Location& loc, const CollisionData *data) {
     b2BodyDef def;
     def.type = b2_dynamicBody;
     def.position = { loc.pos.x * BOX2D_SCALE, loc.pos.y * BOX2D_SCALE };
-    auto body = m_world.CreateBody(&def);
+    auto body = createMovingBody(def);
     addFixtureToBody(body, loc.floor, true, false, data);
     return Body(loc.floor, body);
   }
@@ -381,19 +723,180 @@ namespace akgr {
     b2BodyDef def;
     def.type = b2_kinematicBody;
     def.position = { loc.pos.x * BOX2D_SCALE, loc.pos.y * BOX2D_SCALE };
-    auto body = m_world.CreateBody(&def);
+    auto body = createMovingBody(def);
     addFixtureToBody(body, loc.floor, true, false, data);
+
+    m_characterBodies.push_back(body);
+    m_activityDirty = true;
+
     return Body(loc.floor, body);
   }
 
-  void PhysicsModel::loadMap(tmx::Map& map) {
-    assert(m_listener == nullptr);
+  void PhysicsModel::destroyBody(b2Body *body) {
+    assert(body != nullptr);
 
+    delete static_cast<Transform*>(body->GetUserData());
+    body->SetUserData(nullptr);
+
+    auto it = std::find(m_characterBodies.begin(), m_characterBodies.end(), body);
+
+    if (it != m_characterBodies.end()) {
+      m_characterBodies.erase(it);
+    }
+
+    m_world.DestroyBody(body);
+  }
+
+  void PhysicsModel::setActivityRadius(unsigned radius) {
+    m_activityRadius = radius;
+    m_activityDirty = true;
+  }
+
+  void PhysicsModel::updateActivity(const Location& focus) {
+    if (m_activityRadius == 0 || m_gridUnit == 0) {
+      return;
+    }
+
+    int x = static_cast<int>(std::floor(focus.pos.x / m_gridUnit));
+    int y = static_cast<int>(std::floor(focus.pos.y / m_gridUnit));
+
+    // the activity only changes when the hero changes its cell or its floor
+    if (!m_activityDirty && x == m_focusX && y == m_focusY && focus.floor == m_focusFloor) {
+      return;
+    }
+
+    m_activityDirty = false;
+    m_focusX = x;
+    m_focusY = y;
+    m_focusFloor = focus.floor;
+
+    game::ProfileScope scope("PhysicsModel::updateActivity");
+
+    // the floor of a body is given by its filter, it follows the floor changes
+    auto floorBits = bitsFromFloor(focus.floor);
+    int radius = static_cast<int>(m_activityRadius);
+
+    for (auto body : m_characterBodies) {
+      b2Fixture *fixture = body->GetFixtureList();
+      bool active = fixture != nullptr && fixture->GetFilterData().categoryBits == floorBits;
+
+      if (active) {
+        b2Vec2 pos = body->GetPosition();
+        int bodyX = static_cast<int>(std::floor(pos.x / BOX2D_SCALE / m_gridUnit));
+        int bodyY = static_cast<int>(std::floor(pos.y / BOX2D_SCALE / m_gridUnit));
+        active = std::abs(bodyX - x) <= radius && std::abs(bodyY - y) <= radius;
+      }
+
+      // changing the activity adds or removes the fixtures from the broad-phase
+      if (body->IsActive() != active) {
+        body->SetActive(active);
+      }
+    }
+  }
+
+  game::EventStatus PhysicsModel::onHeroLocation(game::EventType type, game::Event *event) {
+    assert(type == HeroLocationEvent::type);
+    updateActivity(static_cast<HeroLocationEvent *>(event)->loc);
+    return game::EventStatus::KEEP;
+  }
+
+  void PhysicsModel::beginMap(const MapCache& cache) {
+    assert(m_listener == nullptr);
     m_listener = new PhysicsListener;
 
-    ZoneConstructor visitor(*m_listener);
-    map.visitLayers(visitor);
+    m_gridUnit = cache.getGridUnit();
+    m_activityDirty = true;
+  }
+
+  void PhysicsModel::loadLayer(const MapCache& cache, const MapCache::Layer& layer) {
+    assert(layer.type == MapCache::LayerType::ZONE || layer.type == MapCache::LayerType::SPRITE);
+    assert(m_listener);
+
+    if (layer.type == MapCache::LayerType::SPRITE) {
+      // only the sprites with a collision data are added, cell by cell
+      return;
+    }
+
+    game::Log::info(game::Log::PHYSICS, "Loading zone layer: '%s' (floor: %i)\n", cache.getString(layer.name), layer.floor);
+    game::Log::info(game::Log::PHYSICS, "\tZones in the layer: %u\n", layer.count);
+  }
+
+  void PhysicsModel::loadCell(const MapCache& cache, const MapCache::Layer& layer, std::size_t cell) {
+    if (layer.type == MapCache::LayerType::SPRITE) {
+      loadSpriteCell(cache, layer, cell);
+      return;
+    }
+
+    if (layer.type != MapCache::LayerType::ZONE) {
+      return;
+    }
+
+    assert(m_listener);
+
+    int floor = layer.floor;
+    const MapCache::ZoneRecord *zones = cache.getZones(layer);
+    const uint32_t *cells = cache.getCells(layer);
+
+    if (cells[cell] == cells[cell + 1]) {
+      return;
+    }
+
+    b2Body *body = getCellBody(cell, floor);
+    std::vector<CollisionRectangle> rectangles;
+
+    for (uint32_t i = cells[cell]; i < cells[cell + 1]; ++i) {
+      const MapCache::ZoneRecord& zone = zones[i];
+
+      switch (zone.type) {
+        case MapCache::ZoneType::EVENT:
+          m_listener->addEventZone(body, floor, cache, zone);
+          break;
+        case MapCache::ZoneType::COLLISION:
+          if (zone.shape == MapCache::ZoneShape::RECTANGLE) {
+            rectangles.push_back({ zone.x, zone.y, zone.x + zone.width, zone.y + zone.height });
+          } else {
+            m_listener->addCollisionZone(body, floor, cache, zone);
+          }
+          break;
+      }
+    }
+
+    createBakedFixtures(body, floor, rectangles);
+  }
+
+  void PhysicsModel::loadSpriteCell(const MapCache& cache, const MapCache::Layer& layer, std::size_t cell) {
+    const MapCache::SpriteRecord *records = cache.getSprites(layer);
+    const uint32_t *cells = cache.getCells(layer);
+
+    for (uint32_t i = cells[cell]; i < cells[cell + 1]; ++i) {
+      const MapCache::SpriteRecord& record = records[i];
+      auto collisionData = gDataManager().findCollisionDataFor(record.id);
+
+      if (collisionData) {
+        Location loc;
+        loc.floor = layer.floor;
+        loc.pos = { record.x, record.y };
+        addMapItem(loc, collisionData, cell);
+      }
+    }
+  }
+
+  void PhysicsModel::unloadCell(std::size_t cell) {
+    auto it = m_cellBodies.find(cell);
+
+    if (it == m_cellBodies.end()) {
+      return;
+    }
+
+    for (auto& floorBody : it->second) {
+      m_listener->removeZones(floorBody.second);
+      destroyBody(floorBody.second);
+    }
+
+    m_cellBodies.erase(it);
+  }
 
+  void PhysicsModel::endMap(const MapCache& cache) {
     m_world.SetContactListener(m_listener);
   }
 
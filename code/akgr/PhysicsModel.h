@@ -21,21 +21,24 @@
 #define AKGR_PHYSICS_MODEL_H
 
 #include <cinttypes>
+#include <map>
+#include <vector>
 
 #include <Box2D/Box2D.h>
-#include <tmx/Map.h>
 
+#include <game/Event.h>
 #include <game/Model.h>
 
 #include "Body.h"
 #include "Data.h"
+#include "MapLoader.h"
 
 namespace akgr {
   uint16_t bitsFromFloor(int floor);
 
   class PhysicsListener;
 
-  class PhysicsModel : public game::Model {
+  class PhysicsModel : public game::Model, public MapSink {
   public:
     static constexpr float BOX2D_SCALE = 0.02f;
 
@@ -50,17 +53,73 @@ namespace akgr {
     }
 
     virtual void update(float dt) override;
+    virtual void interpolate(float alpha) override;
 
-    void addMapItem(const Location& loc, const CollisionData *data);
+    /*
+     * The transform of a moving body at the time of the rendered frame
+     */
+    b2Vec2 getInterpolatedPosition(const b2Body *body) const;
+    float getInterpolatedAngle(const b2Body *body) const;
+
+    void addMapItem(const Location& loc, const CollisionData *data, std::size_t cell);
 
     Body createHeroBody(const Location& loc, const CollisionData *data);
     Body createCharacterBody(const Location& loc, const CollisionData *data);
 
-    void loadMap(tmx::Map& map);
+    /*
+     * Destroy a body and release the data attached to it
+     */
+    void destroyBody(b2Body *body);
+
+    /*
+     * The character bodies are active only on the floor of the hero and in
+     * the cells at less than the radius from the hero cell, 0 means that
+     * they are always active
+     */
+    void setActivityRadius(unsigned radius);
+
+    virtual void beginMap(const MapCache& cache) override;
+    virtual void loadLayer(const MapCache& cache, const MapCache::Layer& layer) override;
+    virtual void loadCell(const MapCache& cache, const MapCache::Layer& layer, std::size_t cell) override;
+    virtual void unloadCell(std::size_t cell) override;
+    virtual void endMap(const MapCache& cache) override;
+
+  private:
+    void updateActivity(const Location& focus);
+    game::EventStatus onHeroLocation(game::EventType type, game::Event *event);
+
+    void loadSpriteCell(const MapCache& cache, const MapCache::Layer& layer, std::size_t cell);
+
+    /*
+     * All the static fixtures of a cell on a floor are in one body, created
+     * on demand
+     */
+    b2Body *getCellBody(std::size_t cell, int floor);
+
+    /*
+     * A moving body has its transform before the last step in its user data
+     */
+    b2Body *createMovingBody(const b2BodyDef& def);
 
   private:
     b2World m_world;
     PhysicsListener *m_listener;
+    std::map<std::size_t, std::map<int, b2Body*>> m_cellBodies;
+
+    struct Transform {
+      b2Vec2 position;
+      float angle;
+    };
+
+    float m_alpha;
+
+    unsigned m_gridUnit;
+    unsigned m_activityRadius;
+    std::vector<b2Body*> m_characterBodies;
+    bool m_activityDirty;
+    int m_focusX;
+    int m_focusY;
+    int m_focusFloor;
   };
 
 }
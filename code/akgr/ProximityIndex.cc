@@ -0,0 +1,130 @@
+/*
+ * Akagoria, the revenge of Kalista
+ * a single-player RPG in an open world with a top-down view.
+ *
+ * Copyright (c) 2013-2015, Julien Bernard
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "ProximityIndex.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "Maths.h"
+
+namespace akgr {
+
+  static int computeCoordinate(float value) {
+    return static_cast<int>(std::floor(value / ProximityIndex::CELL_SIZE));
+  }
+
+  uint64_t ProximityIndex::computeKey(int floor, int x, int y) {
+    // 8 bits for the floor, 28 bits for each coordinate
+    return (static_cast<uint64_t>(floor & 0xFF) << 56) | (static_cast<uint64_t>(x & 0xFFFFFFF) << 28) | static_cast<uint64_t>(y & 0xFFFFFFF);
+  }
+
+  uint64_t ProximityIndex::computeKey(const Location& loc) {
+    return computeKey(loc.floor, computeCoordinate(loc.pos.x), computeCoordinate(loc.pos.y));
+  }
+
+  std::size_t ProximityIndex::addItem(std::size_t index, const Location& loc) {
+    std::size_t handle = m_items.size();
+    uint64_t key = computeKey(loc);
+    m_items.push_back({ index, loc, key });
+    insertHandle(key, handle);
+    return handle;
+  }
+
+  void ProximityIndex::updateItem(std::size_t handle, const Location& loc) {
+    assert(handle < m_items.size());
+    Item& item = m_items[handle];
+    item.loc = loc;
+
+    uint64_t key = computeKey(loc);
+
+    if (key == item.key) {
+      return;
+    }
+
+    removeHandle(item.key, handle);
+    insertHandle(key, handle);
+    item.key = key;
+  }
+
+  void ProximityIndex::clear() {
+    m_items.clear();
+    m_buckets.clear();
+  }
+
+  std::vector<std::size_t> ProximityIndex::queryItems(const Location& loc, float radius) const {
+    int xmin = computeCoordinate(loc.pos.x - radius);
+    int xmax = computeCoordinate(loc.pos.x + radius);
+    int ymin = computeCoordinate(loc.pos.y - radius);
+    int ymax = computeCoordinate(loc.pos.y + radius);
+
+    std::vector<std::pair<float, std::size_t>> found;
+
+    for (int x = xmin; x <= xmax; ++x) {
+      for (int y = ymin; y <= ymax; ++y) {
+        auto it = m_buckets.find(computeKey(loc.floor, x, y));
+
+        if (it == m_buckets.end()) {
+          continue;
+        }
+
+        for (auto handle : it->second) {
+          const Item& item = m_items[handle];
+          float d2 = squareDistance(item.loc.pos, loc.pos);
+
+          if (item.loc.floor == loc.floor && d2 < radius * radius) {
+            found.emplace_back(d2, item.index);
+          }
+        }
+      }
+    }
+
+    std::sort(found.begin(), found.end());
+
+    std::vector<std::size_t> indices;
+
+    for (auto& match : found) {
+      indices.push_back(match.second);
+    }
+
+    return indices;
+  }
+
+  void ProximityIndex::insertHandle(uint64_t key, std::size_t handle) {
+    m_buckets[key].push_back(handle);
+  }
+
+  void ProximityIndex::removeHandle(uint64_t key, std::size_t handle) {
+    auto it = m_buckets.find(key);
+    assert(it != m_buckets.end());
+
+    auto& handles = it->second;
+    auto pos = std::find(handles.begin(), handles.end(), handle);
+    assert(pos != handles.end());
+
+    *pos = handles.back();
+    handles.pop_back();
+
+    if (handles.empty()) {
+      m_buckets.erase(it);
+    }
+  }
+
+}
@@ -0,0 +1,68 @@
+/*
+ * Akagoria, the revenge of Kalista
+ * a single-player RPG in an open world with a top-down view.
+ *
+ * Copyright (c) 2013-2015, Julien Bernard
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef AKGR_PROXIMITY_INDEX_H
+#define AKGR_PROXIMITY_INDEX_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "Location.h"
+
+namespace akgr {
+
+  /*
+   * A spatial hash of the interactable things, per floor.
+   *
+   * Each item has an index given by its owner. The query gives the indices
+   * of the items within a radius of a location, the nearest first. The cost
+   * of a query only depends on the items around the location.
+   */
+  class ProximityIndex {
+  public:
+    static constexpr float CELL_SIZE = 128.0f;
+
+    std::size_t addItem(std::size_t index, const Location& loc);
+    void updateItem(std::size_t handle, const Location& loc);
+    void clear();
+
+    std::vector<std::size_t> queryItems(const Location& loc, float radius) const;
+
+  private:
+    struct Item {
+      std::size_t index;
+      Location loc;
+      uint64_t key;
+    };
+
+    static uint64_t computeKey(int floor, int x, int y);
+    static uint64_t computeKey(const Location& loc);
+
+    void insertHandle(uint64_t key, std::size_t handle);
+    void removeHandle(uint64_t key, std::size_t handle);
+
+  private:
+    std::vector<Item> m_items;
+    std::unordered_map<uint64_t, std::vector<std::size_t>> m_buckets;
+  };
+
+}
+
+#endif // AKGR_PROXIMITY_INDEX_H
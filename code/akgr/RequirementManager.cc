@@ -37,6 +37,7 @@ namespace akgr {
 
   void RequirementManager::addRequirement(game::Id req) {
     m_requirements.insert(req);
+    setBit(m_current, getIndex(req));
   }
 
   void RequirementManager::removeRequirement(const std::string& req) {
@@ -46,6 +47,47 @@ namespace akgr {
 
   void RequirementManager::removeRequirement(game::Id req) {
     m_requirements.erase(req);
+    resetBit(m_current, getIndex(req));
+  }
+
+  std::size_t RequirementManager::getIndex(game::Id req) {
+    auto it = m_indices.find(req);
+
+    if (it != m_indices.end()) {
+      return it->second;
+    }
+
+    std::size_t index = m_indices.size();
+    m_indices.insert(std::make_pair(req, index));
+    return index;
+  }
+
+  void RequirementManager::updateCurrent() {
+    m_current.clear();
+
+    for (auto req : m_requirements) {
+      setBit(m_current, getIndex(req));
+    }
+  }
+
+  static constexpr std::size_t WORD_BITS = 64;
+
+  void RequirementManager::setBit(RequirementSet& reqs, std::size_t index) {
+    std::size_t word = index / WORD_BITS;
+
+    if (word >= reqs.size()) {
+      reqs.resize(word + 1, 0);
+    }
+
+    reqs[word] |= UINT64_C(1) << (index % WORD_BITS);
+  }
+
+  void RequirementManager::resetBit(RequirementSet& reqs, std::size_t index) {
+    std::size_t word = index / WORD_BITS;
+
+    if (word < reqs.size()) {
+      reqs[word] &= ~(UINT64_C(1) << (index % WORD_BITS));
+    }
   }
 
 }
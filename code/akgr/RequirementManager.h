@@ -21,8 +21,11 @@
 #define AKGR_REQUIREMENT_MANAGER_H
 
 #include <algorithm>
+#include <cstdint>
+#include <map>
 #include <set>
 #include <string>
+#include <vector>
 
 #include <boost/serialization/serialization.hpp>
 #include <boost/serialization/set.hpp>
@@ -31,8 +34,14 @@
 
 namespace akgr {
 
+  /*
+   * Each requirement that is seen gets a dense index, so that a set of
+   * requirements can be compiled once into a bitset and checked with a few
+   * word operations. The bitsets grow with the number of requirements.
+   */
   class RequirementManager {
   public:
+    typedef std::vector<uint64_t> RequirementSet;
 
     bool hasRequirement(const std::string& req);
     bool hasRequirement(game::Id req);
@@ -44,14 +53,46 @@ namespace akgr {
       });
     }
 
+    template<class Iterator>
+    RequirementSet compileRequirements(Iterator first, Iterator last) {
+      RequirementSet reqs;
+
+      std::for_each(first, last, [this, &reqs](game::Id req) {
+        setBit(reqs, getIndex(req));
+      });
+
+      return reqs;
+    }
+
+    bool hasRequirements(const RequirementSet& reqs) const {
+      for (std::size_t i = 0; i < reqs.size(); ++i) {
+        uint64_t current = i < m_current.size() ? m_current[i] : 0;
+
+        if ((reqs[i] & current) != reqs[i]) {
+          return false;
+        }
+      }
+
+      return true;
+    }
+
     void addRequirement(const std::string& req);
     void addRequirement(game::Id req);
 
     void removeRequirement(const std::string& req);
     void removeRequirement(game::Id req);
 
+  private:
+    std::size_t getIndex(game::Id req);
+    void updateCurrent();
+
+    static void setBit(RequirementSet& reqs, std::size_t index);
+    static void resetBit(RequirementSet& reqs, std::size_t index);
+
   private:
     std::set<game::Id> m_requirements;
+    std::map<game::Id, std::size_t> m_indices;
+    RequirementSet m_current;
 
   private:
     friend class boost::serialization::access;
@@ -59,6 +100,10 @@ namespace akgr {
     template<class Archive>
     void serialize(Archive & ar, const unsigned int file_version) {
       ar & m_requirements;
+
+      if (Archive::is_loading::value) {
+        updateCurrent();
+      }
     }
   };
 
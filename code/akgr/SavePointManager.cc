@@ -29,6 +29,7 @@
 #include <boost/archive/text_oarchive.hpp>
 
 #include <game/Log.h>
+#include <game/Profiler.h>
 
 #include "Character.h"
 #include "Hero.h"
@@ -100,6 +101,7 @@ namespace akgr {
       return;
     }
 
+    game::ProfileScope scope("SavePointManager::loadFromSlot");
     std::ifstream file(path.string());
 
     boost::archive::text_iarchive archive(file);
@@ -19,6 +19,8 @@
  */
 #include "ShrineManager.h"
 
+#include <cassert>
+
 #include "GameEvents.h"
 #include "HeroAttributes.h"
 #include "MapEvents.h"
@@ -51,9 +53,36 @@ namespace akgr {
       particle.clockwise = (i % 2 == 0);
     }
 
+    m_index.addItem(m_particlesSystems.size(), loc);
     m_particlesSystems.emplace_back(std::move(system));
   }
 
+  void ShrineManager::loadLayer(const MapCache& cache, const MapCache::Layer& layer) {
+    assert(layer.type == MapCache::LayerType::SPRITE);
+
+    // shrines are known even when their cell is not loaded
+    const MapCache::SpriteRecord *records = cache.getSprites(layer);
+
+    for (uint32_t i = 0; i < layer.count; ++i) {
+      const MapCache::SpriteRecord& record = records[i];
+
+      Location loc;
+      loc.floor = layer.floor;
+      loc.pos = { record.x, record.y };
+
+      switch (record.id) {
+        case "TomoShrine"_id:
+          addShrineManager(loc, Shrine::TOMO);
+          break;
+        case "PonaShrine"_id:
+          addShrineManager(loc, Shrine::PONA);
+          break;
+        default:
+          break;
+      }
+    }
+  }
+
   void ShrineManager::update(float dt) {
     int floor = m_tracker.getFloor();
 
@@ -74,7 +103,7 @@ namespace akgr {
     }
   }
 
-  void ShrineManager::render(sf::RenderWindow& window) {
+  void ShrineManager::render(game::RenderQueue& queue) {
     int floor = m_tracker.getFloor();
 
     for (const auto& system : m_particlesSystems) {
@@ -101,6 +130,7 @@ namespace akgr {
       }
 
       const sf::Vector2f& center = system.loc.pos;
+      std::vector<sf::Vector2f> positions;
 
       for (std::size_t i = 0; i < PARTICLES_COUNT; ++i) {
         const auto& particle = system.particles[i];
@@ -109,9 +139,16 @@ namespace akgr {
         float x = center.x + rho * std::cos(particle.theta);
         float y = center.y + rho * std::sin(particle.theta);
 
-        shape.setPosition(x, y);
-        window.draw(shape);
+        positions.emplace_back(x, y);
       }
+
+      // the particles are copied, they may be drawn during the next update
+      queue.addCustom(getPriority(), [shape, positions](sf::RenderTarget& target) mutable {
+        for (auto& position : positions) {
+          shape.setPosition(position);
+          target.draw(shape);
+        }
+      });
     }
   }
 
@@ -120,23 +157,16 @@ namespace akgr {
   game::EventStatus ShrineManager::onUse(game::EventType type, game::Event *event) {
     auto useEvent = static_cast<UseEvent *>(event);
 
-    for (const auto& system : m_particlesSystems) {
-      if (system.loc.floor == useEvent->loc.floor) {
-        float d2 = squareDistance(system.loc.pos, useEvent->loc.pos);
-//         game::Log::info(game::Log::GENERAL, "Distance: %f\n", std::sqrt(d2));
-
-        if (d2 < SHRINE_DISTANCE * SHRINE_DISTANCE) {
-          switch (system.shrine) {
-            case Shrine::PONA:
-              gHeroAttributes().increaseHP(0.1f);
-              break;
-            case Shrine::TOMO:
-              useEvent->kind = UseEvent::SAVE;
-              break;
-            default:
-              break;
-          }
-        }
+    for (auto index : m_index.queryItems(useEvent->loc, SHRINE_DISTANCE)) {
+      switch (m_particlesSystems[index].shrine) {
+        case Shrine::PONA:
+          gHeroAttributes().increaseHP(0.1f);
+          break;
+        case Shrine::TOMO:
+          useEvent->kind = UseEvent::SAVE;
+          break;
+        default:
+          break;
       }
     }
 
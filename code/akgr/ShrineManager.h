@@ -28,6 +28,8 @@
 
 #include "FloorTracker.h"
 #include "Location.h"
+#include "MapLoader.h"
+#include "ProximityIndex.h"
 
 namespace akgr {
 
@@ -38,14 +40,16 @@ namespace akgr {
     TOMO,
   };
 
-  class ShrineManager : public game::Entity {
+  class ShrineManager : public game::Entity, public MapSink {
   public:
     ShrineManager();
 
     void addShrineManager(const Location& loc, Shrine shrine);
 
+    virtual void loadLayer(const MapCache& cache, const MapCache::Layer& layer) override;
+
     virtual void update(float dt) override;
-    virtual void render(sf::RenderWindow& window) override;
+    virtual void render(game::RenderQueue& queue) override;
 
   private:
     struct Particle {
@@ -65,6 +69,7 @@ namespace akgr {
 
     FloorTracker m_tracker;
     std::vector<ParticleSystem> m_particlesSystems;
+    ProximityIndex m_index;
 
   private:
     game::EventStatus onUse(game::EventType type, game::Event *event);
@@ -35,6 +35,7 @@ namespace akgr {
 
   game::Singleton<game::Random> gRandom;
   game::Singleton<game::ResourceManager> gResourceManager;
+  game::Singleton<game::TextureAtlas> gTextureAtlas;
   game::Singleton<game::EventManager> gEventManager;
   game::Singleton<game::EntityManager> gMainEntityManager;
   game::Singleton<game::EntityManager> gHeadsUpEntityManager;
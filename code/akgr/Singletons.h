@@ -25,11 +25,13 @@
 #include <game/Random.h>
 #include <game/ResourceManager.h>
 #include <game/Singleton.h>
+#include <game/TextureAtlas.h>
 #include <game/WindowGeometry.h>
 
 namespace akgr {
   extern game::Singleton<game::Random> gRandom;
   extern game::Singleton<game::ResourceManager> gResourceManager;
+  extern game::Singleton<game::TextureAtlas> gTextureAtlas;
   extern game::Singleton<game::EventManager> gEventManager;
   extern game::Singleton<game::EntityManager> gMainEntityManager;
   extern game::Singleton<game::EntityManager> gHeadsUpEntityManager;
@@ -19,188 +19,143 @@
  */
 #include "SpriteMap.h"
 
-#include <tmx/LayerVisitor.h>
-#include <tmx/ObjectLayer.h>
-#include <tmx/TileLayer.h>
-
 #include <game/Log.h>
 
-#include "DataManager.h"
-#include "ShrineManager.h"
 #include "Singletons.h"
-#include "PhysicsModel.h"
 
 namespace akgr {
 
-  template class GridMap<Sprite>;
-
-  static constexpr unsigned SPRITE_MAP_UNIT = 1600; /* 25 * 64 */
-
-  namespace {
-
-    struct SpriteConstructor : public tmx::LayerVisitor {
-
-      SpriteConstructor(SpriteMap& spriteMap, const std::string& kind)
-      : m_spriteMap(spriteMap)
-      , m_kind(kind)
-      {
-
-      }
-
-      virtual void visitObjectLayer(const tmx::Map& map, const tmx::ObjectLayer& layer) override {
-        if (!layer.hasProperty("kind")) {
-          game::Log::warning(game::Log::GRAPHICS, "No kind for the layer: '%s'\n", layer.getName().c_str());
-          return;
-        }
-
-        if (layer.getProperty("kind", "") != m_kind) {
-          return;
-        }
-
-        int floor = std::stoi(layer.getProperty("floor", "0"));
-
-        game::Log::info(game::Log::GRAPHICS, "Loading sprite layer: '%s' (floor: %i)\n", layer.getName().c_str(), floor);
-
-        unsigned count = 0;
-
-        for (auto obj : layer) {
-          const std::string& name = obj->getName();
-
-          if (!obj->isTile()) {
-            game::Log::warning(game::Log::GRAPHICS, "Object is not a tile: '%s'\n", name.c_str());
-            continue;
-          }
+  template class GridMap<Sprite, std::vector<SpriteBatch>>;
 
-          auto tile = static_cast<const tmx::TileObject *>(obj);
-
-          unsigned gid = tile->getGID();
-          assert(gid != 0);
-
-          auto tileset = map.getTileSetFromGID(gid);
-          auto image = tileset->getImage();
-          sf::Texture *texture = gResourceManager().getTexture(image->getSource().string());
-          assert(texture);
-          texture->setSmooth(true);
-
-          tmx::Size size;
-
-          if (image->hasSize()) {
-            size = image->getSize();
-          } else {
-            sf::Vector2u textureSize = texture->getSize();
-            size.width = textureSize.x;
-            size.height = textureSize.y;
-          }
-
-          gid = gid - tileset->getFirstGID();
-          tmx::Rect rect = tileset->getCoords(gid, size);
-
-          Sprite sprite;
-
-          sprite.floor = floor;
-
-          auto angle = tile->getRotation();
-
-          sf::Vector2f center;
-          center.x = tile->getX();
-          center.y = tile->getY();
-
-          sf::Transform transform;
-          transform.rotate(angle, center);
+  SpriteMap::SpriteMap(int priority)
+  : GridMap<Sprite, std::vector<SpriteBatch>>(priority) {
 
-          sprite.angle = angle;
+  }
 
-          sf::Vector2f pos;
-          pos.x = tile->getX() + rect.width / 2;
-          pos.y = tile->getY() - tileset->getTileHeight() + rect.height / 2;
+  SpriteMap::~SpriteMap() {
+    waitForPrefetch();
+  }
 
-          sprite.pos = transform.transformPoint(pos);
+  void SpriteMap::beginMap(const MapCache& cache) {
+    // the same grid as the cache, to load the sprites cell by cell
+    initialize(cache.getWidth(), cache.getHeight(), cache.getGridUnit());
+  }
 
-          sprite.rect.left = rect.x;
-          sprite.rect.top = rect.y;
-          sprite.rect.width = rect.width;
-          sprite.rect.height = rect.height;
+  void SpriteMap::loadLayer(const MapCache& cache, const MapCache::Layer& layer) {
+    assert(layer.type == MapCache::LayerType::SPRITE);
 
-          sprite.texture = texture;
+    int floor = layer.floor;
 
-          m_spriteMap.addSprite(sprite);
-          count++;
+    game::Log::info(game::Log::GRAPHICS, "Loading sprite layer: '%s' (floor: %i)\n", cache.getString(layer.name), floor);
+    game::Log::info(game::Log::GRAPHICS, "\tSprites in the layer: %u\n", layer.count);
+  }
 
-          Location loc;
-          loc.floor = floor;
-          loc.pos = sprite.pos;
+  void SpriteMap::loadCell(const MapCache& cache, const MapCache::Layer& layer, std::size_t cell) {
+    if (layer.type != MapCache::LayerType::SPRITE) {
+      return;
+    }
 
-          switch (game::Hash(name)) {
-            case "TomoShrine"_id:
-              gShrineManager().addShrineManager(loc, Shrine::TOMO);
-              break;
-            case "PonaShrine"_id:
-              gShrineManager().addShrineManager(loc, Shrine::PONA);
-              break;
-            default:
-              break;
-          }
+    int floor = layer.floor;
+    const MapCache::SpriteRecord *records = cache.getSprites(layer);
+    const uint32_t *cells = cache.getCells(layer);
 
-          auto collisionData = gDataManager().getCollisionDataFor(name);
+    for (uint32_t i = cells[cell]; i < cells[cell + 1]; ++i) {
+      const MapCache::SpriteRecord& record = records[i];
 
-          if (collisionData) {
-            gPhysicsModel().addMapItem(loc, collisionData);
-          }
-        }
+      auto path = cache.getPath(record.texture);
+      sf::Texture *texture = gTextureAtlas().getTexture(path);
+      sf::Vector2i offset(0, 0);
 
-        game::Log::info(game::Log::GRAPHICS, "\tSprites loaded: %u\n", count);
+      if (texture != nullptr) {
+        offset = gTextureAtlas().getPosition(path);
+      } else {
+        texture = gResourceManager().getTexture(path);
+        assert(texture);
+        texture->setSmooth(true);
       }
 
-    private:
-      SpriteMap& m_spriteMap;
-      const std::string& m_kind;
-    };
-
-  }
-
-  SpriteMap::SpriteMap(int priority)
-  : GridMap<Sprite>(priority) {
+      Sprite sprite;
+      sprite.floor = floor;
+      sprite.angle = record.angle;
+      sprite.pos = { record.x, record.y };
+      sprite.rect = { record.left + offset.x, record.top + offset.y, record.width, record.height };
+      sprite.texture = texture;
 
+      addObject(sprite, cell);
+    }
   }
 
-  void SpriteMap::loadMap(const tmx::Map& map, const std::string& kind) {
-    initialize(map.getWidth() * map.getTileWidth(), map.getHeight() * map.getTileHeight(), SPRITE_MAP_UNIT);
-
-    SpriteConstructor visitor(*this, kind);
-    map.visitLayers(visitor);
+  void SpriteMap::unloadCell(std::size_t cell) {
+    clearCell(cell);
   }
 
   void SpriteMap::addSprite(const Sprite& sprite) {
     addObject(sprite, sprite.pos);
   }
 
+  static SpriteBatch& getBatch(std::vector<SpriteBatch>& batches, sf::Texture *texture) {
+    for (auto& batch : batches) {
+      if (batch.texture == texture) {
+        return batch;
+      }
+    }
+
+    batches.push_back({ texture, CellVertices() });
+    return batches.back();
+  }
+
   void SpriteMap::update(float dt)  {
     if (!isDirty()) {
       return;
     }
 
-    m_sprites.clear();
+    buildVisibleCells();
+    setClean();
+  }
 
-    processObjects([this](const Sprite& sprite) {
-      if (sprite.floor == getFloor()) {
-        m_sprites.push_back(&sprite);
+  void SpriteMap::render(game::RenderQueue& queue)  {
+    processVisibleCells(queue.getView(), [this, &queue](const std::vector<SpriteBatch>& batches, const CellClip& clip) {
+      for (auto& batch : batches) {
+        batch.vertices.draw(queue, getPriority(), batch.texture, clip);
       }
     });
+  }
 
-    std::sort(m_sprites.begin(), m_sprites.end(), [](const Sprite *lhs, const Sprite *rhs) {
-      return lhs->texture < rhs->texture;
-    });
+  void SpriteMap::buildCell(const std::vector<Sprite>& sprites, std::vector<SpriteBatch>& batches) const {
+    float subUnit = getSubUnit();
 
-    setClean();
+    for (auto& sprite : sprites) {
+      sf::Vector2f size(sprite.rect.width, sprite.rect.height);
+
+      // same transformation as a sf::Sprite with its origin at the center
+      sf::Transform transform;
+      transform.translate(sprite.pos);
+      transform.rotate(sprite.angle);
+      transform.translate(- size / 2.0f);
+
+      float left = sprite.rect.left;
+      float top = sprite.rect.top;
+      float right = left + sprite.rect.width;
+      float bottom = top + sprite.rect.height;
+
+      sf::Vertex quad[4] = {
+        sf::Vertex(transform.transformPoint(0.0f, 0.0f), sf::Vector2f(left, top)),
+        sf::Vertex(transform.transformPoint(size.x, 0.0f), sf::Vector2f(right, top)),
+        sf::Vertex(transform.transformPoint(size.x, size.y), sf::Vector2f(right, bottom)),
+        sf::Vertex(transform.transformPoint(0.0f, size.y), sf::Vector2f(left, bottom))
+      };
+
+      getBatch(batches, sprite.texture).vertices.addQuad(quad, subUnit);
+    }
+
+    for (auto& batch : batches) {
+      batch.vertices.finish();
+    }
   }
 
-  void SpriteMap::render(sf::RenderWindow& window)  {
-    for (auto spriteData : m_sprites) {
-      sf::Sprite sprite(*spriteData->texture, spriteData->rect);
-      sprite.setPosition(spriteData->pos);
-      sprite.setOrigin(spriteData->rect.width / 2, spriteData->rect.height / 2);
-      sprite.setRotation(spriteData->angle);
-      window.draw(sprite);
+  void SpriteMap::uploadCell(std::vector<SpriteBatch>& batches) {
+    for (auto& batch : batches) {
+      batch.vertices.upload();
     }
   }
 
@@ -20,9 +20,8 @@
 #ifndef AKGR_SPRITE_MAP_H
 #define AKGR_SPRITE_MAP_H
 
-#include <tmx/Map.h>
-
 #include "GridMap.h"
+#include "MapLoader.h"
 
 namespace akgr {
 
@@ -34,21 +33,31 @@ namespace akgr {
     sf::Texture *texture;
   };
 
-  extern template class GridMap<Sprite>;
+  struct SpriteBatch {
+    sf::Texture *texture;
+    CellVertices vertices;
+  };
+
+  extern template class GridMap<Sprite, std::vector<SpriteBatch>>;
 
-  class SpriteMap : public GridMap<Sprite> {
+  class SpriteMap : public GridMap<Sprite, std::vector<SpriteBatch>>, public MapSink {
   public:
     SpriteMap(int priority);
+    ~SpriteMap();
 
-    void loadMap(const tmx::Map& map, const std::string& kind);
+    virtual void beginMap(const MapCache& cache) override;
+    virtual void loadLayer(const MapCache& cache, const MapCache::Layer& layer) override;
+    virtual void loadCell(const MapCache& cache, const MapCache::Layer& layer, std::size_t cell) override;
+    virtual void unloadCell(std::size_t cell) override;
 
     void addSprite(const Sprite& sprite);
 
     virtual void update(float dt) override;
-    virtual void render(sf::RenderWindow& window) override;
+    virtual void render(game::RenderQueue& queue) override;
 
-  private:
-    std::vector<const Sprite*> m_sprites;
+  protected:
+    virtual void buildCell(const std::vector<Sprite>& sprites, std::vector<SpriteBatch>& batches) const override;
+    virtual void uploadCell(std::vector<SpriteBatch>& batches) override;
   };
 
 }
@@ -87,8 +87,8 @@ namespace akgr {
     m_currentUI->update(dt);
   }
 
-  void StartDriver::render(sf::RenderWindow& window) {
-    m_currentUI->render(window);
+  void StartDriver::render(game::RenderQueue& queue) {
+    m_currentUI->render(queue);
   }
 
 }
@@ -43,7 +43,7 @@ namespace akgr {
     StartChoice onUse();
 
     void update(float dt);
-    void render(sf::RenderWindow& window);
+    void render(game::RenderQueue& queue);
 
   private:
     enum class Mode {
@@ -43,7 +43,7 @@ namespace akgr {
     akgr::gRequirementManager().addRequirement("IntroDialogReq"_id);
 
     // another character
-    auto shagirLocation = akgr::gDataManager().getPointOfInterestDataFor("Shagir");
+    auto shagirLocation = akgr::gDataManager().getPointOfInterestDataFor("Shagir"_id);
     assert(shagirLocation);
     auto shagirCharacter = akgr::gCharacterManager().addCharacter("Shagir", shagirLocation->loc, 0.5f);
     shagirCharacter->attachDialog("ShagirConversation0");
@@ -19,148 +19,90 @@
  */
 #include "TileMap.h"
 
-#include <tmx/LayerVisitor.h>
-#include <tmx/ObjectLayer.h>
-#include <tmx/TileLayer.h>
-
 #include <game/Log.h>
 
 #include "Singletons.h"
 
 namespace akgr {
 
-  template class GridMap<Tile>;
-
-static constexpr unsigned TILE_MAP_UNIT = 1600; /* 25 * 64 */
-
-  namespace {
-
-    struct TileConstructor : public tmx::LayerVisitor {
-      TileConstructor(TileMap& tileMap, const std::string& kind)
-      : m_tileMap(tileMap)
-      , m_kind(kind)
-      {
-
-      }
-
-      virtual void visitTileLayer(const tmx::Map& map, const tmx::TileLayer& layer) override {
-        if (!layer.hasProperty("kind")) {
-          game::Log::warning(game::Log::GRAPHICS, "No kind for the layer: '%s'\n", layer.getName().c_str());
-          return;
-        }
-
-        if (layer.getProperty("kind", "") != m_kind) {
-          return;
-        }
+  template class GridMap<Tile, CellVertices>;
 
-        int floor = std::stoi(layer.getProperty("floor", "0"));
-
-        game::Log::info(game::Log::GRAPHICS, "Loading tile layer: '%s' (floor: %i)\n", layer.getName().c_str(), floor);
-
-        unsigned tileWidth = map.getTileWidth();
-        assert(tileWidth);
-
-        unsigned tileHeight = map.getTileHeight();
-        assert(tileHeight);
-
-        unsigned width = map.getWidth();
-        assert(width);
+  TileMap::TileMap(int priority)
+  : GridMap<Tile, CellVertices>(priority), m_texture(nullptr) {
 
-        unsigned height = map.getHeight();
-        assert(height);
+  }
 
-        sf::Texture *texture = nullptr;
-        tmx::Size size;
+  TileMap::~TileMap() {
+    waitForPrefetch();
+  }
 
-        unsigned k = 0;
-        unsigned count = 0;
+  void TileMap::setTexture(sf::Texture *texture) {
+    assert(m_texture == nullptr || texture == m_texture);
+    m_texture = texture;
+  }
 
-        for (auto cell : layer) {
-          unsigned i = k % width;
-          unsigned j = k / width;
-          assert(j < height);
-          k++;
 
-          unsigned gid = cell.getGID();
+  void TileMap::beginMap(const MapCache& cache) {
+    // the same grid as the cache, to load the tiles cell by cell
+    initialize(cache.getWidth(), cache.getHeight(), cache.getGridUnit());
+  }
 
-          if (gid == 0) {
-            continue;
-          }
+  void TileMap::loadLayer(const MapCache& cache, const MapCache::Layer& layer) {
+    assert(layer.type == MapCache::LayerType::TILE);
 
-          auto tileset = map.getTileSetFromGID(gid);
+    game::Log::info(game::Log::GRAPHICS, "Loading tile layer: '%s' (floor: %i)\n", cache.getString(layer.name), layer.floor);
 
-          if (texture == nullptr) {
-            assert(tileset->getTileWidth() == tileWidth);
-            assert(tileset->getTileHeight() == tileHeight);
+    if (layer.count == 0) {
+      return;
+    }
 
-            auto image = tileset->getImage();
-            texture = gResourceManager().getTexture(image->getSource().string());
-            assert(texture);
-            texture->setSmooth(true);
+    auto path = cache.getPath(layer.texture);
+    sf::Texture *texture = gTextureAtlas().getTexture(path);
+    sf::Vector2f offset(0.0f, 0.0f);
 
-            if (image->hasSize()) {
-              size = image->getSize();
-            } else {
-              sf::Vector2u texture_size = texture->getSize();
-              size.width = texture_size.x;
-              size.height = texture_size.y;
-            }
+    if (texture != nullptr) {
+      offset = sf::Vector2f(gTextureAtlas().getPosition(path));
+    } else {
+      texture = gResourceManager().getTexture(path);
+      assert(texture);
+      texture->setSmooth(true);
+    }
 
-            m_tileMap.setTexture(texture);
-          } else {
-            assert(texture == gResourceManager().getTexture(tileset->getImage()->getSource().string()));
-          }
+    setTexture(texture);
+    m_offsets[&layer] = offset;
 
-          gid = gid - tileset->getFirstGID();
-          tmx::Rect rect = tileset->getCoords(gid, size);
+    game::Log::info(game::Log::GRAPHICS, "\tTiles in the layer: %u\n", layer.count);
+  }
 
-          Tile tile;
+  void TileMap::loadCell(const MapCache& cache, const MapCache::Layer& layer, std::size_t cell) {
+    auto it = m_offsets.find(&layer);
 
-          tile.floor = floor;
+    if (it == m_offsets.end()) {
+      return;
+    }
 
-          // define its 4 corners
-          tile.position[0] = sf::Vector2f(i * tileWidth, j * tileHeight);
-          tile.position[1] = sf::Vector2f((i + 1) * tileWidth, j * tileHeight);
-          tile.position[2] = sf::Vector2f((i + 1) * tileWidth, (j + 1) * tileHeight);
-          tile.position[3] = sf::Vector2f(i * tileWidth, (j + 1) * tileHeight);
+    const uint32_t *cells = cache.getCells(layer);
 
-          // define its 4 texture coordinates
-          tile.texCoords[0] = sf::Vector2f(rect.x, rect.y);
-          tile.texCoords[1] = sf::Vector2f(rect.x + rect.width, rect.y);
-          tile.texCoords[2] = sf::Vector2f(rect.x + rect.width, rect.y + rect.height);
-          tile.texCoords[3] = sf::Vector2f(rect.x, rect.y + rect.height);
+    if (cells[cell] == cells[cell + 1]) {
+      return;
+    }
 
-          m_tileMap.addTile(tile);
-          count++;
-        }
+    // move the texture coordinates into the atlas
+    const Tile *first = cache.getTiles(layer) + cells[cell];
+    const Tile *last = cache.getTiles(layer) + cells[cell + 1];
+    std::vector<Tile> tiles(first, last);
 
-        game::Log::info(game::Log::GRAPHICS, "\tTiles loaded: %u\n", count);
+    for (auto& tile : tiles) {
+      for (auto& coords : tile.texCoords) {
+        coords += it->second;
       }
+    }
 
-
-    private:
-      TileMap& m_tileMap;
-      const std::string& m_kind;
-    };
-
-  }
-
-  TileMap::TileMap(int priority)
-  : GridMap<Tile>(priority), m_texture(nullptr) {
-
-  }
-
-  void TileMap::setTexture(sf::Texture *texture) {
-    assert(m_texture == nullptr || texture == m_texture);
-    m_texture = texture;
+    addObjects(cell, tiles.begin(), tiles.end());
   }
 
-
-  void TileMap::loadMap(tmx::Map& map, const std::string& kind) {
-    initialize(map.getWidth() * map.getTileWidth(), map.getHeight() * map.getTileHeight(), TILE_MAP_UNIT);
-
-    TileConstructor visitor(*this, kind);
-    map.visitLayers(visitor);
+  void TileMap::unloadCell(std::size_t cell) {
+    clearCell(cell);
   }
 
   void TileMap::addTile(const Tile& tile) {
@@ -172,26 +114,38 @@ static constexpr unsigned TILE_MAP_UNIT = 1600; /* 25 * 64 */
       return;
     }
 
-    m_vertices.clear();
-    m_vertices.setPrimitiveType(sf::Quads);
-
-    processObjects([this](const Tile& tile) {
-      if (tile.floor == getFloor()) {
-        for (std::size_t i = 0; i < 4; ++i) {
-          m_vertices.append(sf::Vertex(tile.position[i], tile.texCoords[i]));
-        }
-      }
-    });
-
+    buildVisibleCells();
     setClean();
   }
 
-  void TileMap::render(sf::RenderWindow& window)  {
+  void TileMap::render(game::RenderQueue& queue)  {
     if (!m_texture) {
       return;
     }
 
-    window.draw(m_vertices, m_texture);
+    processVisibleCells(queue.getView(), [this, &queue](const CellVertices& vertices, const CellClip& clip) {
+      vertices.draw(queue, getPriority(), m_texture, clip);
+    });
+  }
+
+  void TileMap::buildCell(const std::vector<Tile>& tiles, CellVertices& vertices) const {
+    float subUnit = getSubUnit();
+
+    for (auto& tile : tiles) {
+      sf::Vertex quad[4];
+
+      for (std::size_t i = 0; i < 4; ++i) {
+        quad[i] = sf::Vertex(tile.position[i], tile.texCoords[i]);
+      }
+
+      vertices.addQuad(quad, subUnit);
+    }
+
+    vertices.finish();
+  }
+
+  void TileMap::uploadCell(CellVertices& vertices) {
+    vertices.upload();
   }
 
 }
@@ -20,35 +20,37 @@
 #ifndef AKGR_TILE_MAP_H
 #define AKGR_TILE_MAP_H
 
-#include <tmx/Map.h>
-
 #include "GridMap.h"
+#include "MapLoader.h"
+#include "Tile.h"
 
 namespace akgr {
 
-  struct Tile {
-    int floor;
-    std::array<sf::Vector2f, 4> position;
-    std::array<sf::Vector2f, 4> texCoords;
-  };
-
-  extern template class GridMap<Tile>;
+  extern template class GridMap<Tile, CellVertices>;
 
-  class TileMap : public GridMap<Tile> {
+  class TileMap : public GridMap<Tile, CellVertices>, public MapSink {
   public:
     TileMap(int priority);
+    ~TileMap();
 
-    void loadMap(tmx::Map& map, const std::string& kind);
+    virtual void beginMap(const MapCache& cache) override;
+    virtual void loadLayer(const MapCache& cache, const MapCache::Layer& layer) override;
+    virtual void loadCell(const MapCache& cache, const MapCache::Layer& layer, std::size_t cell) override;
+    virtual void unloadCell(std::size_t cell) override;
 
     void setTexture(sf::Texture *texture);
     void addTile(const Tile& tile);
 
     virtual void update(float dt) override;
-    virtual void render(sf::RenderWindow& window) override;
+    virtual void render(game::RenderQueue& queue) override;
+
+  protected:
+    virtual void buildCell(const std::vector<Tile>& tiles, CellVertices& vertices) const override;
+    virtual void uploadCell(CellVertices& vertices) override;
 
   private:
     sf::Texture *m_texture;
-    sf::VertexArray m_vertices;
+    std::map<const MapCache::Layer *, sf::Vector2f> m_offsets;
   };
 
 
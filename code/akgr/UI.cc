@@ -19,6 +19,8 @@
  */
 #include "UI.h"
 
+#include <algorithm>
+
 #include <game/WindowGeometry.h>
 
 #include "DataManager.h"
@@ -82,7 +84,9 @@ namespace akgr {
   }
 
 
-  static void drawBox(sf::RenderWindow& window, float x, float y, float width, float height) {
+  static constexpr int UI_PRIORITY = 0;
+
+  static void drawBox(game::RenderQueue& queue, float x, float y, float width, float height) {
     static const sf::Color fillColor(0x04, 0x08, 0x84, 0xC0);
 
     sf::RectangleShape boxShape({ width, height });
@@ -90,25 +94,28 @@ namespace akgr {
     boxShape.setFillColor(fillColor);
     boxShape.setOutlineColor(sf::Color::White);
     boxShape.setOutlineThickness(1);
-    window.draw(boxShape);
+    queue.addDrawable(UI_PRIORITY, boxShape);
   }
 
-  static void drawText(sf::RenderWindow& window, sf::Font& font, float x, float y, unsigned size, const sf::String& str) {
-    sf::Text text(str, font, size);
-    auto rect = text.getLocalBounds();
-    text.setColor(sf::Color::White);
-    text.setOrigin(rect.left, rect.top);
-    text.setPosition(x, y);
-    window.draw(text);
+  static void drawText(game::RenderQueue& queue, sf::Font& font, float x, float y, unsigned size, const sf::String& str) {
+    // the text is laid out when it is drawn, the font is only used on the render thread
+    queue.addCustom(UI_PRIORITY, [&font, x, y, size, str](sf::RenderTarget& target) {
+      sf::Text text(str, font, size);
+      auto rect = text.getLocalBounds();
+      text.setColor(sf::Color::White);
+      text.setOrigin(rect.left, rect.top);
+      text.setPosition(x, y);
+      target.draw(text);
+    });
   }
 
-  static void drawPointer(sf::RenderWindow& window, float x, float y) {
+  static void drawPointer(game::RenderQueue& queue, float x, float y) {
     sf::CircleShape pointer(STANDARD_POINTER_RADIUS, 3);
     pointer.setOrigin(STANDARD_POINTER_RADIUS, STANDARD_POINTER_RADIUS);
     pointer.setPosition(x, y);
     pointer.rotate(90);
     pointer.setFillColor(sf::Color::White);
-    window.draw(pointer);
+    queue.addDrawable(UI_PRIORITY, pointer);
   }
 
   static constexpr unsigned SPEAKER_SIZE = 16;
@@ -133,19 +140,19 @@ namespace akgr {
     m_currentLine = &line;
   }
 
-  void DialogUI::render(sf::RenderWindow& window) {
+  void DialogUI::render(game::RenderQueue& queue) {
     assert(m_currentLine);
 
     float x = gWindowGeometry().getXCentered(WORDS_WIDTH);
     float y = gWindowGeometry().getYFromBottom(WORDS_HEIGHT + WORDS_BOTTOM);
 
     // draw speaker box and text
-    drawBox(window, x + WORDS_PADDING, y - SPEAKER_HEIGHT, SPEAKER_WIDTH, SPEAKER_HEIGHT);
-    drawText(window, *m_font, x + WORDS_PADDING + SPEAKER_PADDING, y - SPEAKER_HEIGHT + SPEAKER_PADDING, SPEAKER_SIZE, m_currentLine->speaker);
+    drawBox(queue, x + WORDS_PADDING, y - SPEAKER_HEIGHT, SPEAKER_WIDTH, SPEAKER_HEIGHT);
+    drawText(queue, *m_font, x + WORDS_PADDING + SPEAKER_PADDING, y - SPEAKER_HEIGHT + SPEAKER_PADDING, SPEAKER_SIZE, m_currentLine->speaker);
 
     // draw words box and text
-    drawBox(window, x, y, WORDS_WIDTH, WORDS_HEIGHT);
-    drawText(window, *m_font, x + WORDS_PADDING, y + WORDS_PADDING, WORDS_SIZE, m_currentLine->words);
+    drawBox(queue, x, y, WORDS_WIDTH, WORDS_HEIGHT);
+    drawText(queue, *m_font, x + WORDS_PADDING, y + WORDS_PADDING, WORDS_SIZE, m_currentLine->words);
   }
 
 
@@ -167,12 +174,12 @@ namespace akgr {
     m_currentMessage = &message;
   }
 
-  void MessageUI::render(sf::RenderWindow& window) {
+  void MessageUI::render(game::RenderQueue& queue) {
     assert(m_currentMessage);
 
     float x = gWindowGeometry().getXCentered(MESSAGE_WIDTH);
-    drawBox(window, x, MESSAGE_TOP, MESSAGE_WIDTH, MESSAGE_HEIGHT);
-    drawText(window, *m_font, x + MESSAGE_PADDING, MESSAGE_TOP + MESSAGE_PADDING, MESSAGE_SIZE, m_currentMessage->message);
+    drawBox(queue, x, MESSAGE_TOP, MESSAGE_WIDTH, MESSAGE_HEIGHT);
+    drawText(queue, *m_font, x + MESSAGE_PADDING, MESSAGE_TOP + MESSAGE_PADDING, MESSAGE_SIZE, m_currentMessage->message);
   }
 
 
@@ -206,55 +213,85 @@ namespace akgr {
 
 
   SplashUI::SplashUI()
-  : m_titleString(getMessage("SplashTitle"))
+  : m_progress(-1.0f)
+  , m_titleString(getMessage("SplashTitle"))
   , m_loadingString(getMessage("SplashLoading"))
   {
     m_font = gResourceManager().getFont("fonts/DejaVuSans.ttf");
     assert(m_font);
   }
 
-  void SplashUI::render(sf::RenderWindow& window) {
-    displaySplashMessage(window, false);
+  void SplashUI::render(game::RenderQueue& queue) {
+    displaySplashMessage(queue, false);
   }
 
   static constexpr float LOADING_PADDING = 60.0f;
-
-  void SplashUI::displaySplashMessage(sf::RenderWindow& window, bool loading) {
-    // define a splash message
-    sf::Text text;
-    text.setFont(*m_font);
-    text.setCharacterSize(32);
-    text.setColor(sf::Color(0xFF, 0x80, 0x00));
-    text.setString(m_titleString);
-
-    // put the splash screen in the center
-    sf::FloatRect rect = text.getLocalBounds();
-    text.setOrigin(rect.left, rect.top);
-
-    float x = gWindowGeometry().getXCentered(rect.width);
-    float y = gWindowGeometry().getYCentered(rect.height);
-
-    text.setPosition(x, y);
-    window.draw(text);
-
-    if (loading) {
-      sf::Text loadingText;
-      loadingText.setFont(*m_font);
-      loadingText.setCharacterSize(20);
-      loadingText.setColor(sf::Color(0xFF, 0x80, 0x00));
-      loadingText.setString(m_loadingString);
-      loadingText.setStyle(sf::Text::Italic);
+  static constexpr float PROGRESS_PADDING = 40.0f;
+  static constexpr float PROGRESS_WIDTH = 300.0f;
+  static constexpr float PROGRESS_HEIGHT = 4.0f;
+
+  void SplashUI::displaySplashMessage(game::RenderQueue& queue, bool loading) {
+    // the texts are laid out when they are drawn, with a copy of the geometry
+    game::WindowGeometry geometry = gWindowGeometry();
+    sf::Font *font = m_font;
+    sf::String titleString = m_titleString;
+    sf::String loadingString = m_loadingString;
+    float progress = m_progress;
+
+    queue.addCustom(UI_PRIORITY, [=](sf::RenderTarget& target) mutable {
+      // define a splash message
+      sf::Text text;
+      text.setFont(*font);
+      text.setCharacterSize(32);
+      text.setColor(sf::Color(0xFF, 0x80, 0x00));
+      text.setString(titleString);
 
       // put the splash screen in the center
-      sf::FloatRect loadingRect = loadingText.getLocalBounds();
-      loadingText.setOrigin(loadingRect.left, loadingRect.top);
-
-      float loadingX = gWindowGeometry().getXCentered(loadingRect.width);
-      float loadingY = y + LOADING_PADDING;
-
-      loadingText.setPosition(loadingX, loadingY);
-      window.draw(loadingText);
-    }
+      sf::FloatRect rect = text.getLocalBounds();
+      text.setOrigin(rect.left, rect.top);
+
+      float x = geometry.getXCentered(rect.width);
+      float y = geometry.getYCentered(rect.height);
+
+      text.setPosition(x, y);
+      target.draw(text);
+
+      if (loading) {
+        sf::Text loadingText;
+        loadingText.setFont(*font);
+        loadingText.setCharacterSize(20);
+        loadingText.setColor(sf::Color(0xFF, 0x80, 0x00));
+        loadingText.setString(loadingString);
+        loadingText.setStyle(sf::Text::Italic);
+
+        // put the splash screen in the center
+        sf::FloatRect loadingRect = loadingText.getLocalBounds();
+        loadingText.setOrigin(loadingRect.left, loadingRect.top);
+
+        float loadingX = geometry.getXCentered(loadingRect.width);
+        float loadingY = y + LOADING_PADDING;
+
+        loadingText.setPosition(loadingX, loadingY);
+        target.draw(loadingText);
+
+        if (progress >= 0.0f) {
+          float progressX = geometry.getXCentered(PROGRESS_WIDTH);
+          float progressY = loadingY + PROGRESS_PADDING;
+
+          sf::RectangleShape progressFrame({ PROGRESS_WIDTH, PROGRESS_HEIGHT });
+          progressFrame.setPosition(progressX, progressY);
+          progressFrame.setFillColor(sf::Color::Transparent);
+          progressFrame.setOutlineColor(sf::Color(0xFF, 0x80, 0x00));
+          progressFrame.setOutlineThickness(1.0f);
+          target.draw(progressFrame);
+
+          sf::RectangleShape progressBar({ PROGRESS_WIDTH * std::min(progress, 1.0f), PROGRESS_HEIGHT });
+          progressBar.setPosition(progressX, progressY);
+          progressBar.setFillColor(sf::Color(0xFF, 0x80, 0x00));
+          target.draw(progressBar);
+        }
+      }
+    });
   }
 
   static constexpr float MENU_POS = 2.0f;
@@ -289,8 +326,8 @@ namespace akgr {
     assert(m_font);
   }
 
-  void SelectSlotUI::render(sf::RenderWindow& window) {
-    drawBox(window, MENU_POS, MENU_POS, SELECT_WIDTH, SELECT_HEIGHT);
+  void SelectSlotUI::render(game::RenderQueue& queue) {
+    drawBox(queue, MENU_POS, MENU_POS, SELECT_WIDTH, SELECT_HEIGHT);
 
     float x = MENU_POS + MENU_LEFT;
     float y = MENU_POS + SELECT_SLOT_MARGIN;
@@ -298,38 +335,38 @@ namespace akgr {
     int choice = getCurrentChoice();
     float pointerX = MENU_POS + MENU_POINTER;
 
-    drawBox(window, x, y, SELECT_SLOT_WIDTH,  SELECT_SLOT_HEIGHT);
-    drawText(window, *m_font, x + SELECT_SLOT_PADDING, y + SELECT_SLOT_MARGIN, SELECT_SLOT_SIZE, gSavePointManager().getSlotInfo(0));
+    drawBox(queue, x, y, SELECT_SLOT_WIDTH,  SELECT_SLOT_HEIGHT);
+    drawText(queue, *m_font, x + SELECT_SLOT_PADDING, y + SELECT_SLOT_MARGIN, SELECT_SLOT_SIZE, gSavePointManager().getSlotInfo(0));
 
     if (choice == 0) {
       float pointerY = y + SELECT_SLOT_HEIGHT / 2;
-      drawPointer(window, pointerX, pointerY);
+      drawPointer(queue, pointerX, pointerY);
     }
 
     y += SELECT_SLOT_HEIGHT + SELECT_SLOT_MARGIN;
-    drawBox(window, x, y, SELECT_SLOT_WIDTH,  SELECT_SLOT_HEIGHT);
-    drawText(window, *m_font, x + SELECT_SLOT_PADDING, y + SELECT_SLOT_MARGIN, SELECT_SLOT_SIZE, gSavePointManager().getSlotInfo(1));
+    drawBox(queue, x, y, SELECT_SLOT_WIDTH,  SELECT_SLOT_HEIGHT);
+    drawText(queue, *m_font, x + SELECT_SLOT_PADDING, y + SELECT_SLOT_MARGIN, SELECT_SLOT_SIZE, gSavePointManager().getSlotInfo(1));
 
     if (choice == 1) {
       float pointerY = y + SELECT_SLOT_HEIGHT / 2;
-      drawPointer(window, pointerX, pointerY);
+      drawPointer(queue, pointerX, pointerY);
     }
 
     y += SELECT_SLOT_HEIGHT + SELECT_SLOT_MARGIN;
-    drawBox(window, x, y, SELECT_SLOT_WIDTH,  SELECT_SLOT_HEIGHT);
-    drawText(window, *m_font, x + SELECT_SLOT_PADDING, y + SELECT_SLOT_MARGIN, SELECT_SLOT_SIZE, gSavePointManager().getSlotInfo(2));
+    drawBox(queue, x, y, SELECT_SLOT_WIDTH,  SELECT_SLOT_HEIGHT);
+    drawText(queue, *m_font, x + SELECT_SLOT_PADDING, y + SELECT_SLOT_MARGIN, SELECT_SLOT_SIZE, gSavePointManager().getSlotInfo(2));
 
     if (choice == 2) {
       float pointerY = y + SELECT_SLOT_HEIGHT / 2;
-      drawPointer(window, pointerX, pointerY);
+      drawPointer(queue, pointerX, pointerY);
     }
 
     y += SELECT_SLOT_HEIGHT + 2 * SELECT_SLOT_MARGIN;
-    drawText(window, *m_font, x, y, STANDARD_SIZE, m_backString);
+    drawText(queue, *m_font, x, y, STANDARD_SIZE, m_backString);
 
     if (choice == 3) {
       float pointerY = y + 0.4 * STANDARD_SIZE;
-      drawPointer(window, pointerX, pointerY);
+      drawPointer(queue, pointerX, pointerY);
     }
 
   }
@@ -352,21 +389,21 @@ namespace akgr {
     assert(m_font);
   }
 
-  void StartUI::render(sf::RenderWindow& window) {
-    drawBox(window, MENU_POS, MENU_POS, START_WIDTH, START_HEIGHT);
+  void StartUI::render(game::RenderQueue& queue) {
+    drawBox(queue, MENU_POS, MENU_POS, START_WIDTH, START_HEIGHT);
 
     float x = MENU_POS + MENU_LEFT;
     float y = MENU_POS + START_PADDING;
 
-    drawText(window, *m_font, x, y, START_SIZE, m_newString);
+    drawText(queue, *m_font, x, y, START_SIZE, m_newString);
     y += START_SIZE + START_PADDING;
-    drawText(window, *m_font, x, y, START_SIZE, m_loadString);
+    drawText(queue, *m_font, x, y, START_SIZE, m_loadString);
     y += START_SIZE + START_PADDING;
-    drawText(window, *m_font, x, y, START_SIZE, m_quitString);
+    drawText(queue, *m_font, x, y, START_SIZE, m_quitString);
 
     float pointerX = MENU_POS + MENU_POINTER;
     float pointerY = MENU_POS + START_PADDING + 0.4f * START_SIZE + getCurrentChoice() * (START_SIZE + START_PADDING);
-    drawPointer(window, pointerX, pointerY);
+    drawPointer(queue, pointerX, pointerY);
   }
 
 
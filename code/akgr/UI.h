@@ -57,7 +57,7 @@ namespace akgr {
 
     void setDialogLine(const DialogData::Line& line);
 
-    virtual void render(sf::RenderWindow& window) override;
+    virtual void render(game::RenderQueue& queue) override;
 
   private:
     sf::Font *m_font;
@@ -70,7 +70,7 @@ namespace akgr {
 
     void setMessage(const MessageData& message);
 
-    virtual void render(sf::RenderWindow& window) override;
+    virtual void render(game::RenderQueue& queue) override;
 
   private:
     sf::Font *m_font;
@@ -87,11 +87,16 @@ namespace akgr {
   public:
     SplashUI();
 
-    virtual void render(sf::RenderWindow& window) override;
+    virtual void render(game::RenderQueue& queue) override;
 
-    void displaySplashMessage(sf::RenderWindow& window, bool loading = false);
+    void displaySplashMessage(game::RenderQueue& queue, bool loading = false);
+
+    void setProgress(float progress) {
+      m_progress = progress;
+    }
 
   private:
+    float m_progress;
     sf::String m_titleString;
     sf::String m_loadingString;
     sf::Font *m_font;
@@ -128,7 +133,7 @@ namespace akgr {
 
     SelectSlotUI();
 
-    virtual void render(sf::RenderWindow& window) override;
+    virtual void render(game::RenderQueue& queue) override;
 
   private:
     sf::String m_backString;
@@ -143,7 +148,7 @@ namespace akgr {
 
     StartUI();
 
-    virtual void render(sf::RenderWindow& window) override;
+    virtual void render(game::RenderQueue& queue) override;
 
   private:
     sf::String m_newString;
@@ -71,6 +71,11 @@ namespace game {
     m_controls.push_back(std::move(ptr));
   }
 
+  void Action::addControl(std::unique_ptr<Control> control) {
+    assert(control);
+    m_controls.push_back(std::move(control));
+  }
+
   void Action::update(const sf::Event& event) {
     for (auto& control : m_controls) {
       control->update(event);
@@ -141,6 +141,13 @@ namespace game {
      * @sa CloseControl
      */
     void addCloseControl();
+
+    /**
+     * @brief Add a control.
+     *
+     * @param control the control, owned by the action.
+     */
+    void addControl(std::unique_ptr<Control> control);
     /** @} */
 
     /**
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2014-2015, Julien Bernard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include "ActionScript.h"
+
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <sstream>
+
+#include "Log.h"
+
+namespace game {
+
+  void ActionScript::addAction(Action& action) {
+    std::unique_ptr<ScriptControl> control(new ScriptControl);
+    m_controls[action.getName()] = control.get();
+    action.addControl(std::move(control));
+  }
+
+  bool ActionScript::loadFromFile(const boost::filesystem::path& path) {
+    std::ifstream file(path.string());
+
+    if (!file) {
+      Log::error(Log::GENERAL, "Could not open the action script: '%s'\n", path.string().c_str());
+      return false;
+    }
+
+    m_steps.clear();
+    m_current = 0;
+    m_frame = 0;
+
+    std::string line;
+    unsigned lineNumber = 0;
+
+    while (std::getline(file, line)) {
+      lineNumber++;
+
+      std::istringstream stream(line);
+      unsigned frame;
+
+      if (line.empty() || line[0] == '#' || !(stream >> frame)) {
+        continue;
+      }
+
+      // the name of an action may contain spaces, the state is the last word
+      std::vector<std::string> words;
+      std::string word;
+
+      while (stream >> word) {
+        words.push_back(word);
+      }
+
+      if (words.size() < 2 || (words.back() != "press" && words.back() != "release")) {
+        Log::warning(Log::GENERAL, "Wrong line in the action script at line %u\n", lineNumber);
+        continue;
+      }
+
+      std::string name = words.front();
+
+      for (std::size_t i = 1; i < words.size() - 1; ++i) {
+        name += ' ';
+        name += words[i];
+      }
+
+      auto it = m_controls.find(name);
+
+      if (it == m_controls.end()) {
+        Log::warning(Log::GENERAL, "Unknown action in the action script at line %u: '%s'\n", lineNumber, name.c_str());
+        continue;
+      }
+
+      m_steps.push_back({ frame, it->second, words.back() == "press" });
+    }
+
+    // the lines of the same frame are played in the order of the file
+    std::stable_sort(m_steps.begin(), m_steps.end(), [](const Step& lhs, const Step& rhs) {
+      return lhs.frame < rhs.frame;
+    });
+
+    Log::info(Log::GENERAL, "Action script loaded: %zu steps\n", m_steps.size());
+    return true;
+  }
+
+  void ActionScript::update() {
+    while (m_current < m_steps.size() && m_steps[m_current].frame <= m_frame) {
+      const Step& step = m_steps[m_current];
+      assert(step.control);
+      step.control->setActive(step.active);
+      m_current++;
+    }
+
+    m_frame++;
+  }
+
+  bool ActionScript::isFinished() const {
+    return m_current == m_steps.size();
+  }
+
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2014-2015, Julien Bernard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef GAME_ACTION_SCRIPT_H
+#define GAME_ACTION_SCRIPT_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "Action.h"
+
+namespace game {
+
+  /**
+   * @brief A scripted stream of actions.
+   *
+   * The script is a text file where each line gives a frame, the name of an
+   * action and a state, either `press` or `release`. Empty lines and lines
+   * starting with `#` are ignored. For example:
+   *
+   * ~~~
+   * # go forward for two seconds, then use
+   * 0 Up press
+   * 120 Up release
+   * 121 Use press
+   * ~~~
+   *
+   * @ingroup graphics
+   */
+  class ActionScript {
+  public:
+    /**
+     * @brief Allow the script to control an action.
+     *
+     * A scripted control is added to the action.
+     *
+     * @param action the action to control.
+     */
+    void addAction(Action& action);
+
+    /**
+     * @brief Load a script from a file.
+     *
+     * The actions must be added before the script is loaded.
+     *
+     * @param path the path of the script.
+     * @return true if the script has been loaded.
+     */
+    bool loadFromFile(const boost::filesystem::path& path);
+
+    /**
+     * @brief Set the controls for the current frame and go to the next frame.
+     */
+    void update();
+
+    /**
+     * @brief Tell whether all the lines of the script have been played.
+     *
+     * @return true if the script is finished.
+     */
+    bool isFinished() const;
+
+    /**
+     * @brief Get the current frame.
+     *
+     * @return the number of updates since the beginning of the script.
+     */
+    unsigned getFrame() const {
+      return m_frame;
+    }
+
+  private:
+    struct Step {
+      unsigned frame;
+      ScriptControl *control;
+      bool active;
+    };
+
+    std::map<std::string, ScriptControl*> m_controls;
+    std::vector<Step> m_steps;
+    std::size_t m_current = 0;
+    unsigned m_frame = 0;
+  };
+
+}
+
+#endif // GAME_ACTION_SCRIPT_H
@@ -71,4 +71,34 @@ namespace game {
     window.draw(sprite);
   }
 
+  void Animation::renderAt(RenderQueue& queue, int priority, const sf::Vector2f& position, float angle) const {
+    if (m_frames.empty()) {
+      Log::error(Log::GRAPHICS, "The animation does not have any frame: %s\n", m_name.c_str());
+      return;
+    }
+
+    const Frame& frame = m_frames[m_current_frame];
+    sf::Vector2f size(frame.bounds.width, frame.bounds.height);
+
+    // same transformation as a sf::Sprite with its origin at the center
+    sf::Transform transform;
+    transform.translate(position);
+    transform.rotate(angle);
+    transform.translate(- size / 2.0f);
+
+    float left = frame.bounds.left;
+    float top = frame.bounds.top;
+    float right = left + frame.bounds.width;
+    float bottom = top + frame.bounds.height;
+
+    sf::Vertex quad[4] = {
+      sf::Vertex(transform.transformPoint(0.0f, 0.0f), sf::Vector2f(left, top)),
+      sf::Vertex(transform.transformPoint(size.x, 0.0f), sf::Vector2f(right, top)),
+      sf::Vertex(transform.transformPoint(size.x, size.y), sf::Vector2f(right, bottom)),
+      sf::Vertex(transform.transformPoint(0.0f, size.y), sf::Vector2f(left, bottom))
+    };
+
+    queue.addQuads(priority, frame.texture, quad, 4);
+  }
+
 }
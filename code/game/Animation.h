@@ -26,6 +26,8 @@
 
 #include <SFML/Graphics.hpp>
 
+#include "RenderQueue.h"
+
 namespace game {
 
   /**
@@ -46,6 +48,7 @@ namespace game {
 
     void update(float dt);
     void renderAt(sf::RenderWindow& window, const sf::Vector2f& position, float angle = 0.0f) const;
+    void renderAt(RenderQueue& queue, int priority, const sf::Vector2f& position, float angle = 0.0f) const;
 
   private:
     struct Frame {
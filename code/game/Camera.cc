@@ -86,6 +86,11 @@ namespace game {
     window.setView(m_view);
   }
 
+  void FixedRatioCamera::configure(RenderQueue& queue) {
+    m_view.setCenter(getCenter());
+    queue.setView(m_view);
+  }
+
 
   FlexibleCamera::FlexibleCamera(float width, const sf::Vector2f& center)
   : SceneCamera(width, center)
@@ -111,6 +116,11 @@ namespace game {
     window.setView(m_view);
   }
 
+  void FlexibleCamera::configure(RenderQueue& queue) {
+    m_view.setCenter(getCenter());
+    queue.setView(m_view);
+  }
+
 
   HeadsUpCamera::HeadsUpCamera(sf::RenderWindow& window) {
     m_view = window.getDefaultView();
@@ -131,4 +141,8 @@ namespace game {
     window.setView(m_view);
   }
 
+  void HeadsUpCamera::configure(RenderQueue& queue) {
+    queue.setView(m_view);
+  }
+
 }
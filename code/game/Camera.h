@@ -24,6 +24,8 @@
 
 #include <SFML/Graphics.hpp>
 
+#include "RenderQueue.h"
+
 namespace game {
 
   /**
@@ -34,6 +36,7 @@ namespace game {
     ~Camera();
     virtual void update(sf::Event& event) = 0;
     virtual void configure(sf::RenderWindow& window) = 0;
+    virtual void configure(RenderQueue& queue) = 0;
   };
 
   /**
@@ -83,6 +86,7 @@ namespace game {
     FixedRatioCamera(float width, float height, const sf::Vector2f& center = sf::Vector2f(0.0f, 0.0f));
     virtual void update(sf::Event& event) override;
     virtual void configure(sf::RenderWindow& window) override;
+    virtual void configure(RenderQueue& queue) override;
 
   private:
     float m_ratio;
@@ -97,6 +101,7 @@ namespace game {
     FlexibleCamera(float width, const sf::Vector2f& center = sf::Vector2f(0.0f, 0.0f));
     virtual void update(sf::Event& event) override;
     virtual void configure(sf::RenderWindow& window) override;
+    virtual void configure(RenderQueue& queue) override;
 
   private:
     sf::View m_view;
@@ -110,6 +115,7 @@ namespace game {
     HeadsUpCamera(sf::RenderWindow& window);
     virtual void update(sf::Event& event) override;
     virtual void configure(sf::RenderWindow& window) override;
+    virtual void configure(RenderQueue& queue) override;
 
   private:
     sf::View m_view;
@@ -148,4 +148,15 @@ namespace game {
     }
   }
 
+
+  // script control
+
+  ScriptControl::ScriptControl()
+    : Control("script", "script") {
+  }
+
+  void ScriptControl::update(const sf::Event& event) {
+    // nothing to do, the control is set by the script
+  }
+
 }
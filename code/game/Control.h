@@ -213,6 +213,24 @@ namespace game {
     virtual void update(const sf::Event& event) override;
   };
 
+  /**
+   * @brief A scripted control.
+   *
+   * The control is not updated by the events, it is activated and
+   * desactivated by an ActionScript.
+   *
+   * @ingroup graphics
+   */
+  class ScriptControl : public Control {
+  public:
+    /**
+     * @brief Construct a scripted control.
+     */
+    ScriptControl();
+
+    virtual void update(const sf::Event& event) override;
+  };
+
 }
 
 #endif // GAME_CONTROL_H
@@ -30,7 +30,7 @@ namespace game {
     // default: do nothing
   }
 
-  void Entity::render(sf::RenderWindow& window) {
+  void Entity::render(RenderQueue& queue) {
     // default: do nothing
   }
 
@@ -24,6 +24,8 @@
 
 #include <SFML/Graphics.hpp>
 
+#include "RenderQueue.h"
+
 namespace game {
 
   /**
@@ -52,7 +54,7 @@ namespace game {
     }
 
     virtual void update(float dt);
-    virtual void render(sf::RenderWindow& window);
+    virtual void render(RenderQueue& queue);
 
   private:
     const int m_priority;
@@ -42,9 +42,9 @@ namespace game {
     }
   }
 
-  void EntityManager::render(sf::RenderWindow& window) {
+  void EntityManager::render(RenderQueue& queue) {
     for (auto entity : m_entities) {
-      entity->render(window);
+      entity->render(queue);
     }
   }
 
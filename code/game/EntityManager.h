@@ -27,6 +27,7 @@
 #include <SFML/Graphics.hpp>
 
 #include "Entity.h"
+#include "RenderQueue.h"
 
 namespace game {
 
@@ -37,7 +38,7 @@ namespace game {
   public:
 
     void update(float dt);
-    void render(sf::RenderWindow& window);
+    void render(RenderQueue& queue);
 
     void addEntity(Entity& e);
     Entity *removeEntity(Entity *e);
@@ -30,4 +30,8 @@ namespace game {
     // default: do nothing
   }
 
+  void Model::interpolate(float alpha) {
+    // default: do nothing
+  }
+
 }
@@ -32,6 +32,12 @@ namespace game {
     virtual ~Model();
 
     virtual void update(float dt);
+
+    /**
+     * Set the position of the rendered frame between the last two updates,
+     * from 0 (the previous update) to 1 (the last update).
+     */
+    virtual void interpolate(float alpha);
   };
 
 }
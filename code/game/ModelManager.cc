@@ -23,13 +23,57 @@
 
 #include <cassert>
 #include <algorithm>
+#include <cmath>
 #include <memory>
 
 namespace game {
 
+  ModelManager::ModelManager()
+  : m_timestep(0.0f)
+  , m_maxSteps(0)
+  , m_accumulator(0.0f)
+  {
+  }
+
+  void ModelManager::setFixedTimestep(float timestep, unsigned maxSteps) {
+    assert(timestep >= 0.0f);
+    assert(timestep == 0.0f || maxSteps > 0);
+    m_timestep = timestep;
+    m_maxSteps = maxSteps;
+    m_accumulator = 0.0f;
+  }
+
   void ModelManager::update(float dt) {
+    if (m_timestep == 0.0f) {
+      for (auto model : m_models) {
+        model->update(dt);
+        model->interpolate(1.0f);
+      }
+
+      return;
+    }
+
+    m_accumulator += dt;
+    unsigned steps = 0;
+
+    while (m_accumulator >= m_timestep && steps < m_maxSteps) {
+      for (auto model : m_models) {
+        model->update(m_timestep);
+      }
+
+      m_accumulator -= m_timestep;
+      steps++;
+    }
+
+    // the simulation is late, it slows down rather than trying to catch up
+    if (m_accumulator >= m_timestep) {
+      m_accumulator = std::fmod(m_accumulator, m_timestep);
+    }
+
+    float alpha = m_accumulator / m_timestep;
+
     for (auto model : m_models) {
-      model->update(dt);
+      model->interpolate(alpha);
     }
   }
 
@@ -30,9 +30,20 @@ namespace game {
 
   /**
    * @ingroup model
+   *
+   * With a fixed timestep, the models are updated with the same time step,
+   * as many times as needed to catch up with the elapsed time, but no more
+   * than a maximum number of steps per frame. Then, the models are told how
+   * far the frame is between the last two steps.
    */
   class ModelManager {
   public:
+    ModelManager();
+
+    /**
+     * Use a fixed timestep, or the time of the frame if the timestep is 0.
+     */
+    void setFixedTimestep(float timestep, unsigned maxSteps);
 
     void update(float dt);
 
@@ -41,6 +52,9 @@ namespace game {
 
   private:
     std::vector<Model *> m_models;
+    float m_timestep;
+    unsigned m_maxSteps;
+    float m_accumulator;
   };
 
 
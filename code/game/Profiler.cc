@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2014-2015, Julien Bernard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include "Profiler.h"
+
+#include <atomic>
+#include <cassert>
+#include <cinttypes>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Log.h"
+
+namespace game {
+
+  struct ProfilerSpan {
+    std::string name;
+    int64_t start;
+    int64_t duration; /* -1 for a counter */
+    int64_t value;
+    unsigned thread;
+  };
+
+  static std::atomic<bool> s_enabled(false);
+  static std::mutex s_mutex;
+  static std::vector<ProfilerSpan> s_spans; // a ring buffer of at most MAX_SPANS spans
+  static std::size_t s_next = 0;
+  static std::size_t s_dropped = 0;
+  static std::vector<std::thread::id> s_threads;
+
+  static const std::chrono::steady_clock::time_point s_origin = std::chrono::steady_clock::now();
+
+  static int64_t toMicroseconds(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+  }
+
+  static unsigned getThreadIndex(std::thread::id id) {
+    for (unsigned i = 0; i < s_threads.size(); ++i) {
+      if (s_threads[i] == id) {
+        return i;
+      }
+    }
+
+    s_threads.push_back(id);
+    return s_threads.size() - 1;
+  }
+
+  // must be called with the lock
+  static void pushSpan(ProfilerSpan span) {
+    if (s_spans.size() < Profiler::MAX_SPANS) {
+      s_spans.push_back(std::move(span));
+      return;
+    }
+
+    // the oldest span is overwritten
+    s_spans[s_next] = std::move(span);
+    s_next = (s_next + 1) % Profiler::MAX_SPANS;
+    s_dropped++;
+  }
+
+  static void writeString(std::FILE *file, const std::string& str) {
+    std::fputc('"', file);
+
+    for (char c : str) {
+      if (c == '"' || c == '\\') {
+        std::fputc('\\', file);
+        std::fputc(c, file);
+      } else if (static_cast<unsigned char>(c) < 0x20) {
+        std::fprintf(file, "\\u%04x", static_cast<unsigned>(c));
+      } else {
+        std::fputc(c, file);
+      }
+    }
+
+    std::fputc('"', file);
+  }
+
+  void Profiler::setEnabled(bool enabled) {
+    s_enabled = enabled;
+  }
+
+  bool Profiler::isEnabled() {
+    return s_enabled;
+  }
+
+  void Profiler::addSpan(std::string name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {
+    if (!s_enabled) {
+      return;
+    }
+
+    ProfilerSpan span;
+    span.name = std::move(name);
+    span.start = toMicroseconds(start - s_origin);
+    span.duration = toMicroseconds(end - start);
+    span.value = 0;
+
+    std::unique_lock<std::mutex> lock(s_mutex);
+    span.thread = getThreadIndex(std::this_thread::get_id());
+    pushSpan(std::move(span));
+  }
+
+  void Profiler::addCounter(const char *name, int64_t value) {
+    if (!s_enabled) {
+      return;
+    }
+
+    ProfilerSpan span;
+    span.name = name;
+    span.start = toMicroseconds(std::chrono::steady_clock::now() - s_origin);
+    span.duration = -1;
+    span.value = value;
+
+    std::unique_lock<std::mutex> lock(s_mutex);
+    span.thread = getThreadIndex(std::this_thread::get_id());
+    pushSpan(std::move(span));
+  }
+
+  bool Profiler::dumpToFile(const boost::filesystem::path& path) {
+    std::FILE *file = std::fopen(path.string().c_str(), "w");
+
+    if (file == nullptr) {
+      Log::error(Log::GENERAL, "Could not open the trace file: '%s'\n", path.string().c_str());
+      return false;
+    }
+
+    std::unique_lock<std::mutex> lock(s_mutex);
+
+    std::fputs("{\"traceEvents\":[\n", file);
+
+    // the oldest span first
+    for (std::size_t i = 0; i < s_spans.size(); ++i) {
+      const ProfilerSpan& span = s_spans[(s_next + i) % s_spans.size()];
+      std::fputs("{\"name\":", file);
+      writeString(file, span.name);
+
+      if (span.duration < 0) {
+        std::fprintf(file, ",\"ph\":\"C\",\"pid\":1,\"tid\":%u,\"ts\":%" PRId64 ",\"args\":{\"value\":%" PRId64 "}}", span.thread, span.start, span.value);
+      } else {
+        std::fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%" PRId64 ",\"dur\":%" PRId64 "}", span.thread, span.start, span.duration);
+      }
+
+      std::fputs(i + 1 < s_spans.size() ? ",\n" : "\n", file);
+    }
+
+    std::fputs("],\"displayTimeUnit\":\"ms\"}\n", file);
+    std::fclose(file);
+
+    Log::info(Log::GENERAL, "Trace written: '%s' (%zu spans, %zu older spans dropped)\n", path.string().c_str(), s_spans.size(), s_dropped);
+    return true;
+  }
+
+  void Profiler::clear() {
+    std::unique_lock<std::mutex> lock(s_mutex);
+    s_spans.clear();
+    s_next = 0;
+    s_dropped = 0;
+  }
+
+  ProfileScope::ProfileScope(const char *name, const char *detail)
+  : m_name(name)
+  , m_detail(detail)
+  , m_start(std::chrono::steady_clock::now())
+  {
+    assert(name != nullptr);
+  }
+
+  ProfileScope::~ProfileScope() {
+    if (!Profiler::isEnabled()) {
+      return;
+    }
+
+    std::string name(m_name);
+
+    if (m_detail != nullptr) {
+      name += ' ';
+      name += m_detail;
+    }
+
+    Profiler::addSpan(std::move(name), m_start, std::chrono::steady_clock::now());
+  }
+
+}
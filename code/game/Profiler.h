@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2014-2015, Julien Bernard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef GAME_PROFILER_H
+#define GAME_PROFILER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+namespace game {
+
+  /**
+   * @ingroup base
+   *
+   * A recorder of timed spans, on any thread.
+   *
+   * The spans are dumped in the Chrome trace event format, that can be read
+   * with chrome://tracing. Nothing is recorded until the profiler is enabled.
+   * Only the last MAX_SPANS spans and counters are kept.
+   */
+  class Profiler {
+  public:
+    static constexpr std::size_t MAX_SPANS = 1 << 18;
+
+    Profiler() = delete;
+
+    static void setEnabled(bool enabled);
+
+    static bool isEnabled();
+
+    static void addSpan(std::string name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end);
+
+    /**
+     * Record the value of a counter at the current time.
+     */
+    static void addCounter(const char *name, int64_t value);
+
+    static bool dumpToFile(const boost::filesystem::path& path);
+
+    static void clear();
+  };
+
+  /**
+   * @ingroup base
+   *
+   * A span from the construction to the destruction of the object. Spans
+   * of the same thread are nested.
+   *
+   * The name of the span is only built if the profiler is enabled, as the
+   * name followed by the detail. Both must outlive the scope.
+   */
+  class ProfileScope {
+  public:
+    explicit ProfileScope(const char *name, const char *detail = nullptr);
+    ~ProfileScope();
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+  private:
+    const char *m_name;
+    const char *m_detail;
+    std::chrono::steady_clock::time_point m_start;
+  };
+
+}
+
+#endif // GAME_PROFILER_H
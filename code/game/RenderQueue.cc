@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2014-2015, Julien Bernard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include "RenderQueue.h"
+
+#include <cassert>
+#include <algorithm>
+
+namespace game {
+
+  static constexpr unsigned RADIX_BITS = 8;
+  static constexpr unsigned RADIX_SIZE = 1 << RADIX_BITS;
+
+  void RenderQueue::addQuads(int priority, const sf::Texture *texture, const sf::Vertex *vertices, std::size_t count) {
+    if (count == 0) {
+      return;
+    }
+
+    assert(count % 4 == 0);
+
+    Command command;
+    command.key = computeKey(priority);
+    command.kind = Kind::QUADS;
+    command.texture = texture;
+    command.buffer = nullptr;
+    command.first = m_vertices.size();
+    command.count = count;
+    m_commands.push_back(command);
+
+    m_vertices.insert(m_vertices.end(), vertices, vertices + count);
+  }
+
+  void RenderQueue::addBuffer(int priority, const sf::Texture *texture, std::shared_ptr<const sf::VertexBuffer> buffer, std::size_t first, std::size_t count) {
+    if (count == 0 || !buffer) {
+      return;
+    }
+
+    Command command;
+    command.key = computeKey(priority);
+    command.kind = Kind::BUFFER;
+    command.texture = texture;
+    command.buffer = std::move(buffer);
+    command.first = first;
+    command.count = count;
+    m_commands.push_back(command);
+  }
+
+  void RenderQueue::addCustom(int priority, CustomDraw draw) {
+    Command command;
+    command.key = computeKey(priority);
+    command.kind = Kind::CUSTOM;
+    command.texture = nullptr;
+    command.buffer = nullptr;
+    command.first = m_customs.size();
+    command.count = 0;
+    m_commands.push_back(command);
+
+    m_customs.push_back(std::move(draw));
+  }
+
+  void RenderQueue::swap(RenderQueue& other) {
+    std::swap(m_view, other.m_view);
+    m_commands.swap(other.m_commands);
+    m_vertices.swap(other.m_vertices);
+    m_customs.swap(other.m_customs);
+  }
+
+  void RenderQueue::flush(sf::RenderTarget& target) {
+    target.setView(m_view);
+    sortCommands();
+
+    m_drawCount = 0;
+    m_commandCount = m_order.size();
+
+    std::size_t i = 0;
+
+    while (i < m_order.size()) {
+      const Command& command = m_commands[m_order[i]];
+
+      switch (command.kind) {
+        case Kind::QUADS: {
+          // gather the consecutive quads with the same key and the same texture
+          std::size_t j = i + 1;
+
+          while (j < m_order.size() && m_commands[m_order[j]].kind == Kind::QUADS && m_commands[m_order[j]].key == command.key
+              && m_commands[m_order[j]].texture == command.texture) {
+            ++j;
+          }
+
+          if (j == i + 1) {
+            target.draw(&m_vertices[command.first], command.count, sf::Quads, command.texture);
+          } else {
+            m_batch.clear();
+
+            for (std::size_t k = i; k < j; ++k) {
+              const Command& quads = m_commands[m_order[k]];
+              auto first = m_vertices.begin() + quads.first;
+              m_batch.insert(m_batch.end(), first, first + quads.count);
+            }
+
+            target.draw(m_batch.data(), m_batch.size(), sf::Quads, command.texture);
+          }
+
+          m_drawCount++;
+          i = j;
+          break;
+        }
+
+        case Kind::BUFFER: {
+          // merge the contiguous ranges of the same buffer
+          std::size_t count = command.count;
+          std::size_t j = i + 1;
+
+          while (j < m_order.size()) {
+            const Command& next = m_commands[m_order[j]];
+
+            if (next.kind != Kind::BUFFER || next.key != command.key || next.texture != command.texture
+                || next.buffer != command.buffer || next.first != command.first + count) {
+              break;
+            }
+
+            count += next.count;
+            ++j;
+          }
+
+          target.draw(*command.buffer, command.first, count, command.texture);
+          m_drawCount++;
+          i = j;
+          break;
+        }
+
+        case Kind::CUSTOM:
+          m_customs[command.first](target);
+          m_drawCount++;
+          i++;
+          break;
+      }
+    }
+
+    m_commands.clear();
+    m_order.clear();
+    m_scratch.clear();
+    m_vertices.clear();
+    m_customs.clear();
+  }
+
+  uint32_t RenderQueue::computeKey(int priority) {
+    // the texture is not part of the key, so that the commands of a
+    // priority keep the order they were added in
+    int clamped = std::max(std::min(priority, INT16_MAX), INT16_MIN);
+    return static_cast<uint32_t>(clamped - INT16_MIN);
+  }
+
+  void RenderQueue::sortCommands() {
+    // least significant digit radix sort, that is stable, on the indices
+    // of the commands so that the commands are not copied
+    m_order.resize(m_commands.size());
+
+    for (std::size_t i = 0; i < m_order.size(); ++i) {
+      m_order[i] = i;
+    }
+
+    m_scratch.resize(m_order.size());
+
+    for (unsigned shift = 0; shift < 16; shift += RADIX_BITS) {
+      std::size_t counts[RADIX_SIZE + 1] = { 0 };
+
+      for (auto index : m_order) {
+        counts[((m_commands[index].key >> shift) & (RADIX_SIZE - 1)) + 1]++;
+      }
+
+      // all the keys have the same digit, nothing to do
+      if (std::find(std::begin(counts), std::end(counts), m_order.size()) != std::end(counts)) {
+        continue;
+      }
+
+      for (unsigned i = 0; i < RADIX_SIZE; ++i) {
+        counts[i + 1] += counts[i];
+      }
+
+      for (auto index : m_order) {
+        m_scratch[counts[(m_commands[index].key >> shift) & (RADIX_SIZE - 1)]++] = index;
+      }
+
+      m_order.swap(m_scratch);
+    }
+  }
+
+}
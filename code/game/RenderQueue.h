@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2014-2015, Julien Bernard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef GAME_RENDER_QUEUE_H
+#define GAME_RENDER_QUEUE_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <SFML/Graphics.hpp>
+
+namespace game {
+
+  /**
+   * @ingroup graphics
+   *
+   * A list of draw commands for a frame, drawn in the order of their
+   * priority.
+   *
+   * The commands are sorted by priority with a stable radix sort, so the
+   * commands with the same priority are drawn in the order they were
+   * added. Consecutive quads with the same priority and the same texture
+   * are drawn with a single draw call, whatever entity they come from.
+   *
+   * The commands do not refer to the state of the entities, so that a
+   * queue can be drawn on another thread while the next frame is updated.
+   */
+  class RenderQueue {
+  public:
+    typedef std::function<void(sf::RenderTarget&)> CustomDraw;
+
+    /**
+     * Set the view of the target for the commands of the queue.
+     */
+    void setView(const sf::View& view) {
+      m_view = view;
+    }
+
+    const sf::View& getView() const {
+      return m_view;
+    }
+
+    /**
+     * Add some quads, that are copied in the queue.
+     */
+    void addQuads(int priority, const sf::Texture *texture, const sf::Vertex *vertices, std::size_t count);
+
+    /**
+     * Add a range of quads in a vertex buffer, that is kept alive until the
+     * queue is flushed.
+     */
+    void addBuffer(int priority, const sf::Texture *texture, std::shared_ptr<const sf::VertexBuffer> buffer, std::size_t first, std::size_t count);
+
+    /**
+     * Add anything else, drawn on its own.
+     */
+    void addCustom(int priority, CustomDraw draw);
+
+    /**
+     * Add a copy of a drawable, e.g. a shape.
+     */
+    template<typename D>
+    void addDrawable(int priority, const D& drawable) {
+      addCustom(priority, [drawable](sf::RenderTarget& target) {
+        target.draw(drawable);
+      });
+    }
+
+    /**
+     * Exchange the commands of two queues.
+     */
+    void swap(RenderQueue& other);
+
+    /**
+     * Draw all the commands and clear the queue.
+     */
+    void flush(sf::RenderTarget& target);
+
+    /**
+     * The number of draw calls of the last flush.
+     */
+    unsigned getDrawCount() const {
+      return m_drawCount;
+    }
+
+    /**
+     * The number of commands of the last flush.
+     */
+    unsigned getCommandCount() const {
+      return m_commandCount;
+    }
+
+  private:
+    enum class Kind {
+      QUADS,
+      BUFFER,
+      CUSTOM,
+    };
+
+    struct Command {
+      uint32_t key;
+      Kind kind;
+      const sf::Texture *texture;
+      std::shared_ptr<const sf::VertexBuffer> buffer;
+      std::size_t first;
+      std::size_t count;
+    };
+
+    static uint32_t computeKey(int priority);
+
+    void sortCommands();
+
+  private:
+    sf::View m_view;
+    std::vector<Command> m_commands;
+    std::vector<std::size_t> m_order; // the indices of the sorted commands
+    std::vector<std::size_t> m_scratch;
+    std::vector<sf::Vertex> m_vertices;
+    std::vector<sf::Vertex> m_batch;
+    std::vector<CustomDraw> m_customs;
+    unsigned m_drawCount = 0;
+    unsigned m_commandCount = 0;
+  };
+
+}
+
+#endif // GAME_RENDER_QUEUE_H
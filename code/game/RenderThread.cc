@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2014-2015, Julien Bernard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include "RenderThread.h"
+
+#include <cassert>
+
+#include <SFML/OpenGL.hpp>
+
+#include "Profiler.h"
+
+namespace game {
+
+  RenderThread::RenderThread(sf::RenderWindow& window)
+  : m_window(window)
+  , m_clearColor(sf::Color::Black)
+  , m_pending(false)
+  , m_stopping(false)
+  {
+  }
+
+  RenderThread::~RenderThread() {
+    stop();
+  }
+
+  void RenderThread::addQueue(RenderQueue& queue) {
+    assert(!isRunning());
+    m_queues.push_back(&queue);
+    m_frame.emplace_back(new RenderQueue);
+  }
+
+  void RenderThread::start() {
+    if (isRunning()) {
+      return;
+    }
+
+    // the context can only be active in one thread
+    m_window.setActive(false);
+
+    // the uploads of the main thread go to a shared context
+    m_uploadContext.reset(new sf::Context);
+
+    m_stopping = false;
+    m_thread = std::thread(&RenderThread::run, this);
+  }
+
+  void RenderThread::stop() {
+    if (!isRunning()) {
+      return;
+    }
+
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_stopping = true;
+    }
+
+    m_condition.notify_all();
+    m_thread.join();
+
+    m_uploadContext.reset();
+    m_window.setActive(true);
+  }
+
+  void RenderThread::submit() {
+    assert(isRunning());
+
+    // the textures and buffers uploaded during the frame must be complete
+    // before they are used in the context of the window
+    glFlush();
+
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+
+      m_condition.wait(lock, [this]() {
+        return !m_pending;
+      });
+
+      // the queues of the thread have been flushed, they are empty
+      for (std::size_t i = 0; i < m_queues.size(); ++i) {
+        m_queues[i]->swap(*m_frame[i]);
+      }
+
+      m_pending = true;
+    }
+
+    m_condition.notify_all();
+  }
+
+  void RenderThread::run() {
+    m_window.setActive(true);
+
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        m_condition.wait(lock, [this]() {
+          return m_pending || m_stopping;
+        });
+
+        // a submitted frame is drawn before stopping
+        if (!m_pending) {
+          break;
+        }
+      }
+
+      unsigned drawCount = 0;
+
+      {
+        ProfileScope scope("RenderThread::frame");
+        m_window.clear(m_clearColor);
+
+        for (auto& queue : m_frame) {
+          queue->flush(m_window);
+          drawCount += queue->getDrawCount();
+        }
+
+        m_window.display();
+      }
+
+      Profiler::addCounter("draw calls", drawCount);
+
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_pending = false;
+      }
+
+      m_condition.notify_all();
+    }
+
+    m_window.setActive(false);
+  }
+
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2014-2015, Julien Bernard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef GAME_RENDER_THREAD_H
+#define GAME_RENDER_THREAD_H
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <SFML/Graphics.hpp>
+
+#include "RenderQueue.h"
+
+namespace game {
+
+  /**
+   * @ingroup graphics
+   *
+   * A thread that owns the context of a window and draws the frames that
+   * are recorded on the main thread.
+   *
+   * The queues of a frame are drawn while the next frame is updated and
+   * recorded. The events are still polled on the main thread. When the
+   * thread is stopped, the window can be used on the main thread again,
+   * e.g. to recreate it.
+   *
+   * While the thread runs, the main thread has its own context, shared
+   * with the context of the window, so that the textures and the vertex
+   * buffers can still be created and updated on the main thread (the
+   * atlas, the resources, the cells of the maps). The commands of the
+   * main context are flushed when a frame is submitted, so that the
+   * objects uploaded while recording the frame are complete when the
+   * frame is drawn.
+   */
+  class RenderThread {
+  public:
+    RenderThread(sf::RenderWindow& window);
+    ~RenderThread();
+
+    RenderThread(const RenderThread&) = delete;
+    RenderThread& operator=(const RenderThread&) = delete;
+
+    /**
+     * Add a queue of the frame, the queues are drawn in the order they
+     * are added.
+     */
+    void addQueue(RenderQueue& queue);
+
+    void setClearColor(const sf::Color& color) {
+      m_clearColor = color;
+    }
+
+    void start();
+    void stop();
+
+    bool isRunning() const {
+      return m_thread.joinable();
+    }
+
+    /**
+     * Hand the recorded queues to the thread, once the previous frame has
+     * been drawn, and the uploads of the main thread to the context of the
+     * window. The queues are empty afterwards.
+     */
+    void submit();
+
+  private:
+    void run();
+
+  private:
+    sf::RenderWindow& m_window;
+    sf::Color m_clearColor;
+    std::unique_ptr<sf::Context> m_uploadContext;
+
+    std::vector<RenderQueue*> m_queues;
+    std::vector<std::unique_ptr<RenderQueue>> m_frame;
+
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_pending;
+    bool m_stopping;
+  };
+
+}
+
+#endif // GAME_RENDER_THREAD_H
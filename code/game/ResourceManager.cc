@@ -21,12 +21,101 @@
  */
 #include "ResourceManager.h"
 
+#include <cassert>
+
 #include <boost/filesystem.hpp>
 
+#include <SFML/Graphics/Image.hpp>
+
+#include "Clock.h"
+#include "Log.h"
+#include "Profiler.h"
+
 namespace fs = boost::filesystem;
 
 namespace game {
 
+  /*
+   * How a resource is decoded on a worker and finished on the main thread
+   */
+  template<typename T>
+  struct ResourceTraits {
+    typedef T Decoded;
+
+    static std::unique_ptr<T> finish(std::unique_ptr<Decoded> decoded) {
+      return decoded;
+    }
+  };
+
+  template<>
+  struct ResourceTraits<sf::Texture> {
+    typedef sf::Image Decoded;
+
+    static std::unique_ptr<sf::Texture> finish(std::unique_ptr<sf::Image> image) {
+      std::unique_ptr<sf::Texture> texture(new sf::Texture);
+
+      if (!texture->loadFromImage(*image)) {
+        return nullptr;
+      }
+
+      return texture;
+    }
+  };
+
+  template<typename T>
+  class ResourceRequest {
+  public:
+    typedef typename ResourceTraits<T>::Decoded Decoded;
+
+    ResourceRequest(const fs::path& requestKey, const fs::path& requestPath)
+    : key(requestKey)
+    , path(requestPath)
+    , decoded(false)
+    , finished(false)
+    , resource(nullptr)
+    {
+    }
+
+    const fs::path key;
+    const fs::path path;
+    std::function<T*()> finish;
+
+    // written by the worker
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool decoded;
+    std::unique_ptr<Decoded> data;
+
+    // written by the main thread
+    std::atomic<bool> finished;
+    T *resource;
+  };
+
+  template<typename T>
+  bool ResourceHandle<T>::isReady() const {
+    return m_request && m_request->finished;
+  }
+
+  template<typename T>
+  T *ResourceHandle<T>::get() const {
+    return isReady() ? m_request->resource : nullptr;
+  }
+
+  template<typename T>
+  T *ResourceHandle<T>::wait() {
+    assert(m_request);
+
+    if (m_request->finished) {
+      return m_request->resource;
+    }
+
+    return m_request->finish();
+  }
+
+  template class ResourceHandle<sf::Font>;
+  template class ResourceHandle<sf::SoundBuffer>;
+  template class ResourceHandle<sf::Texture>;
+
   template<typename T>
   T *ResourceManager::ResourceCache<T>::findResource(const boost::filesystem::path& key) {
     auto it = m_cache.find(key);
@@ -40,17 +129,68 @@ namespace game {
 
   template<typename T>
   T *ResourceManager::ResourceCache<T>::loadResource(const boost::filesystem::path& key, const boost::filesystem::path& path) {
+    ProfileScope scope("load", key.string().c_str());
     std::unique_ptr<T> obj(new T);
 
     bool loaded = obj->loadFromFile(path.string());
     assert(loaded);
 
+    return addResource(key, std::move(obj));
+  }
+
+  template<typename T>
+  T *ResourceManager::ResourceCache<T>::addResource(const boost::filesystem::path& key, std::unique_ptr<T> obj) {
     auto inserted = m_cache.emplace(key, std::move(obj));
     assert(inserted.second);
 
     return inserted.first->second.get();
   }
 
+  template<typename T>
+  std::shared_ptr<ResourceRequest<T>> ResourceManager::ResourceCache<T>::findRequest(const boost::filesystem::path& key) {
+    auto it = m_requests.find(key);
+
+    if (it != m_requests.end()) {
+      return it->second;
+    }
+
+    return nullptr;
+  }
+
+  template<typename T>
+  void ResourceManager::ResourceCache<T>::addRequest(const boost::filesystem::path& key, std::shared_ptr<ResourceRequest<T>> request) {
+    auto inserted = m_requests.emplace(key, std::move(request));
+    assert(inserted.second);
+  }
+
+  template<typename T>
+  void ResourceManager::ResourceCache<T>::removeRequest(const boost::filesystem::path& key) {
+    m_requests.erase(key);
+  }
+
+  ResourceManager::ResourceManager()
+  : m_stopped(false)
+  , m_queued(0)
+  , m_decoded(0)
+  , m_decodeTime(0)
+  , m_loaded(0)
+  , m_uploadTime(0)
+  {
+  }
+
+  ResourceManager::~ResourceManager() {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_stopped = true;
+    }
+
+    m_condition.notify_all();
+
+    for (auto& worker : m_workers) {
+      worker.join();
+    }
+  }
+
   sf::Font *ResourceManager::getFont(const boost::filesystem::path& path) {
     return getResource(path, m_fonts);
   }
@@ -63,6 +203,41 @@ namespace game {
     return getResource(path, m_textures);
   }
 
+  ResourceHandle<sf::Font> ResourceManager::requestFont(const boost::filesystem::path& path) {
+    return requestResource(path, m_fonts);
+  }
+
+  ResourceHandle<sf::SoundBuffer> ResourceManager::requestSoundBuffer(const boost::filesystem::path& path) {
+    return requestResource(path, m_sounds);
+  }
+
+  ResourceHandle<sf::Texture> ResourceManager::requestTexture(const boost::filesystem::path& path) {
+    return requestResource(path, m_textures);
+  }
+
+  void ResourceManager::update(float budget) {
+    Clock clock;
+    std::function<void()> upload;
+
+    while (m_uploads.poll(upload)) {
+      upload();
+
+      if (clock.getElapsedTime().asSeconds() >= budget) {
+        break;
+      }
+    }
+  }
+
+  ResourceStats ResourceManager::getStats() const {
+    ResourceStats stats;
+    stats.queued = m_queued;
+    stats.decoded = m_decoded;
+    stats.loaded = m_loaded;
+    stats.decodeTime = m_decodeTime / 1000000.0f;
+    stats.uploadTime = m_uploadTime / 1000000.0f;
+    return stats;
+  }
+
   template<typename T>
   T *ResourceManager::getResource(const boost::filesystem::path& path, ResourceCache<T>& cache) {
     auto res = cache.findResource(path);
@@ -71,6 +246,12 @@ namespace game {
       return res;
     }
 
+    auto request = cache.findRequest(path);
+
+    if (request) {
+      return finishRequest(*request, cache);
+    }
+
     auto absolute_path = getAbsolutePath(path);
 
     if (absolute_path.empty()) {
@@ -80,4 +261,144 @@ namespace game {
     return cache.loadResource(path, absolute_path);
   }
 
+  template<typename T>
+  ResourceHandle<T> ResourceManager::requestResource(const boost::filesystem::path& path, ResourceCache<T>& cache) {
+    auto request = cache.findRequest(path);
+
+    if (request) {
+      return ResourceHandle<T>(request);
+    }
+
+    request = std::make_shared<ResourceRequest<T>>(path, getAbsolutePath(path));
+
+    auto res = cache.findResource(path);
+
+    if (res != nullptr || request->path.empty()) {
+      request->resource = res;
+      request->finished = true;
+      return ResourceHandle<T>(request);
+    }
+
+    ResourceRequest<T> *raw = request.get();
+
+    request->finish = [this, raw, &cache]() {
+      return finishRequest(*raw, cache);
+    };
+
+    cache.addRequest(path, request);
+    m_queued++;
+
+    addJob([this, request]() {
+      m_queued--;
+
+      ProfileScope scope("decode", request->key.string().c_str());
+      Clock clock;
+      std::unique_ptr<typename ResourceRequest<T>::Decoded> data(new typename ResourceRequest<T>::Decoded);
+
+      if (!data->loadFromFile(request->path.string())) {
+        Log::error(Log::RESOURCES, "Could not load the resource: '%s'\n", request->path.string().c_str());
+        data.reset();
+      }
+
+      m_decodeTime += clock.getElapsedTime().asMicroseconds();
+
+      // counted before it can be finished, and uncounted, by the main thread
+      m_decoded++;
+
+      {
+        std::unique_lock<std::mutex> lock(request->mutex);
+        request->data = std::move(data);
+        request->decoded = true;
+      }
+
+      request->condition.notify_all();
+
+      m_uploads.push([request]() {
+        request->finish();
+      });
+    });
+
+    return ResourceHandle<T>(request);
+  }
+
+  template<typename T>
+  T *ResourceManager::finishRequest(ResourceRequest<T>& request, ResourceCache<T>& cache) {
+    if (request.finished) {
+      return request.resource;
+    }
+
+    std::unique_ptr<typename ResourceRequest<T>::Decoded> data;
+
+    {
+      std::unique_lock<std::mutex> lock(request.mutex);
+      request.condition.wait(lock, [&request]() { return request.decoded; });
+      data = std::move(request.data);
+    }
+
+    ProfileScope scope("upload", request.key.string().c_str());
+    Clock clock;
+
+    if (data) {
+      auto obj = ResourceTraits<T>::finish(std::move(data));
+
+      if (obj) {
+        request.resource = cache.addResource(request.key, std::move(obj));
+      }
+    }
+
+    m_uploadTime += clock.getElapsedTime().asMicroseconds();
+    m_decoded--;
+    m_loaded++;
+
+    request.finished = true;
+
+    T *resource = request.resource;
+    cache.removeRequest(request.key);
+    return resource;
+  }
+
+  void ResourceManager::addJob(std::function<void()> job) {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+
+      if (m_workers.empty()) {
+        unsigned count = std::thread::hardware_concurrency();
+
+        if (count > 1) {
+          count--; // keep a core for the render thread
+        } else {
+          count = 1;
+        }
+
+        for (unsigned i = 0; i < count; ++i) {
+          m_workers.emplace_back(&ResourceManager::runWorker, this);
+        }
+      }
+
+      m_jobs.push_back(std::move(job));
+    }
+
+    m_condition.notify_one();
+  }
+
+  void ResourceManager::runWorker() {
+    for (;;) {
+      std::function<void()> job;
+
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [this]() { return m_stopped || !m_jobs.empty(); });
+
+        if (m_stopped) {
+          return;
+        }
+
+        job = std::move(m_jobs.front());
+        m_jobs.pop_front();
+      }
+
+      job();
+    }
+  }
+
 }
@@ -22,35 +22,148 @@
 #ifndef GAME_RESOURCE_MANAGER_H
 #define GAME_RESOURCE_MANAGER_H
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
 #include <string>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include <SFML/Graphics/Texture.hpp>
 #include <SFML/Graphics/Font.hpp>
 #include <SFML/Audio/SoundBuffer.hpp>
 
 #include "AssetManager.h"
+#include "Queue.h"
 
 namespace game {
 
+  template<typename T>
+  class ResourceRequest;
+
+  /**
+   * @ingroup graphics
+   *
+   * A handle on a resource that is loaded in the background.
+   */
+  template<typename T>
+  class ResourceHandle {
+  public:
+    ResourceHandle() = default;
+
+    bool isValid() const {
+      return m_request != nullptr;
+    }
+
+    /**
+     * Check if the resource is available, without blocking.
+     */
+    bool isReady() const;
+
+    /**
+     * Get the resource, or nullptr if it is not available yet.
+     */
+    T *get() const;
+
+    /**
+     * Block until the resource is available. Must be called on the main
+     * thread, the thread that calls ResourceManager::update().
+     */
+    T *wait();
+
+  private:
+    friend class ResourceManager;
+
+    explicit ResourceHandle(std::shared_ptr<ResourceRequest<T>> request)
+    : m_request(std::move(request))
+    {
+    }
+
+    std::shared_ptr<ResourceRequest<T>> m_request;
+  };
+
+  /**
+   * @ingroup graphics
+   */
+  struct ResourceStats {
+    std::size_t queued;   // requests waiting for a worker
+    std::size_t decoded;  // requests waiting for the upload
+    std::size_t loaded;   // requests completed
+    float decodeTime;     // total time spent decoding (seconds)
+    float uploadTime;     // total time spent uploading (seconds)
+  };
+
   /**
    * @ingroup graphics
    */
   class ResourceManager : public AssetManager {
   public:
+    ResourceManager();
+    ~ResourceManager();
+
+    ResourceManager(const ResourceManager&) = delete;
+    ResourceManager& operator=(const ResourceManager&) = delete;
+
     sf::Font *getFont(const boost::filesystem::path& path);
     sf::SoundBuffer *getSoundBuffer(const boost::filesystem::path& path);
     sf::Texture *getTexture(const boost::filesystem::path& path);
 
+    /**
+     * Start loading a resource in the background.
+     *
+     * The file is decoded on a worker thread. Then the resource is finished
+     * (e.g. uploaded to the GPU) on the main thread, in update(). The render
+     * thread only draws the resources that are finished.
+     *
+     * The handle may be discarded: the request is kept until it is finished,
+     * and the resources are never evicted from the cache, so a later get
+     * returns the same resource (waiting for the request if needed).
+     */
+    ResourceHandle<sf::Font> requestFont(const boost::filesystem::path& path);
+    ResourceHandle<sf::SoundBuffer> requestSoundBuffer(const boost::filesystem::path& path);
+    ResourceHandle<sf::Texture> requestTexture(const boost::filesystem::path& path);
+
+    /**
+     * Finish the decoded resources, within a time budget (seconds). At least
+     * one resource is finished if any is available. Must be called on the
+     * main thread.
+     */
+    void update(float budget);
+
+    /**
+     * Run some work on the worker threads of the resources, e.g. to build
+     * some data in the background.
+     */
+    template<typename R>
+    std::future<R> runJob(std::function<R()> job) {
+      auto task = std::make_shared<std::packaged_task<R()>>(std::move(job));
+      std::future<R> result = task->get_future();
+      addJob([task]() { (*task)(); });
+      return result;
+    }
+
+    ResourceStats getStats() const;
+
   private:
     template<typename T>
     class ResourceCache {
     public:
       T *findResource(const boost::filesystem::path& key);
       T *loadResource(const boost::filesystem::path& key, const boost::filesystem::path& path);
+      T *addResource(const boost::filesystem::path& key, std::unique_ptr<T> obj);
+
+      std::shared_ptr<ResourceRequest<T>> findRequest(const boost::filesystem::path& key);
+      void addRequest(const boost::filesystem::path& key, std::shared_ptr<ResourceRequest<T>> request);
+      void removeRequest(const boost::filesystem::path& key);
     private:
       std::map<boost::filesystem::path, std::unique_ptr<T>> m_cache;
+      std::map<boost::filesystem::path, std::shared_ptr<ResourceRequest<T>>> m_requests;
     };
 
   private:
@@ -61,8 +174,36 @@ namespace game {
   private:
     template<typename T>
     T *getResource(const boost::filesystem::path& path, ResourceCache<T>& cache);
+
+    template<typename T>
+    ResourceHandle<T> requestResource(const boost::filesystem::path& path, ResourceCache<T>& cache);
+
+    template<typename T>
+    T *finishRequest(ResourceRequest<T>& request, ResourceCache<T>& cache);
+
+    void addJob(std::function<void()> job);
+    void runWorker();
+
+  private:
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::deque<std::function<void()>> m_jobs;
+    bool m_stopped;
+
+    Queue<std::function<void()>> m_uploads;
+
+    std::atomic<std::size_t> m_queued;
+    std::atomic<std::size_t> m_decoded;
+    std::atomic<int64_t> m_decodeTime;
+    std::size_t m_loaded;
+    int64_t m_uploadTime;
   };
 
+  extern template class ResourceHandle<sf::Font>;
+  extern template class ResourceHandle<sf::SoundBuffer>;
+  extern template class ResourceHandle<sf::Texture>;
+
 }
 
 #endif // GAME_RESOURCE_MANAGER_H
@@ -0,0 +1,223 @@
+/*
+ * Copyright (c) 2014-2015, Julien Bernard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include "TextureAtlas.h"
+
+#include <cassert>
+#include <algorithm>
+#include <limits>
+
+#include "Log.h"
+#include "Profiler.h"
+
+namespace game {
+
+  static constexpr std::size_t NO_PAGE = std::numeric_limits<std::size_t>::max();
+
+  void TextureAtlas::addImage(const boost::filesystem::path& key, const sf::Image& image) {
+    assert(m_textures.empty());
+
+    Entry& entry = m_entries[key];
+    entry.image.reset(new sf::Image(image));
+    entry.page = NO_PAGE;
+  }
+
+  bool TextureAtlas::addImageFromFile(const boost::filesystem::path& key, const boost::filesystem::path& path) {
+    assert(m_textures.empty());
+
+    if (hasImage(key)) {
+      return true;
+    }
+
+    ProfileScope scope("TextureAtlas::addImageFromFile", key.string().c_str());
+    std::unique_ptr<sf::Image> image(new sf::Image);
+
+    if (!image->loadFromFile(path.string())) {
+      Log::error(Log::GRAPHICS, "Could not load the image for the atlas: '%s'\n", path.string().c_str());
+      return false;
+    }
+
+    Entry& entry = m_entries[key];
+    entry.image = std::move(image);
+    entry.page = NO_PAGE;
+    return true;
+  }
+
+  bool TextureAtlas::hasImage(const boost::filesystem::path& key) const {
+    return m_entries.find(key) != m_entries.end();
+  }
+
+  void TextureAtlas::build(unsigned maxSize) {
+    ProfileScope scope("TextureAtlas::build");
+    std::vector<Entry*> entries;
+
+    for (auto& item : m_entries) {
+      if (item.second.image) {
+        entries.push_back(&item.second);
+      }
+    }
+
+    // the highest images first, so that the shelves are well filled
+    std::stable_sort(entries.begin(), entries.end(), [](const Entry *lhs, const Entry *rhs) {
+      return lhs->image->getSize().y > rhs->image->getSize().y;
+    });
+
+    struct Shelves {
+      unsigned width;
+      unsigned top;
+      unsigned height;
+      unsigned cursor;
+    };
+
+    std::vector<Shelves> pages;
+
+    for (auto entry : entries) {
+      sf::Vector2u size = entry->image->getSize();
+      unsigned width = size.x + 2 * PADDING;
+      unsigned height = size.y + 2 * PADDING;
+
+      if (width > maxSize || height > maxSize) {
+        Log::warning(Log::GRAPHICS, "Image too big for the atlas: %ux%u\n", size.x, size.y);
+        continue;
+      }
+
+      if (pages.empty()) {
+        pages.push_back({ 0, 0, 0, 0 });
+      }
+
+      Shelves *page = &pages.back();
+
+      if (page->cursor + width > maxSize) {
+        // next shelf
+        page->top += page->height;
+        page->height = 0;
+        page->cursor = 0;
+      }
+
+      if (page->top + height > maxSize) {
+        // next page
+        pages.push_back({ 0, 0, 0, 0 });
+        page = &pages.back();
+      }
+
+      entry->page = pages.size() - 1;
+      entry->position = { page->cursor, page->top };
+
+      page->cursor += width;
+      page->width = std::max(page->width, page->cursor);
+      page->height = std::max(page->height, height);
+    }
+
+    m_pages.resize(pages.size());
+
+    for (std::size_t i = 0; i < pages.size(); ++i) {
+      m_pages[i].create(pages[i].width, pages[i].top + pages[i].height, sf::Color::Transparent);
+    }
+
+    for (auto entry : entries) {
+      if (entry->page == NO_PAGE) {
+        entry->image.reset();
+        continue;
+      }
+
+      sf::Image& page = m_pages[entry->page];
+      const sf::Image& image = *entry->image;
+      sf::Vector2u size = image.getSize();
+      unsigned x = entry->position.x + PADDING;
+      unsigned y = entry->position.y + PADDING;
+
+      page.copy(image, x, y);
+
+      // extrude the borders of the image to avoid bleeding with smooth textures
+      for (unsigned k = 1; k <= PADDING; ++k) {
+        page.copy(image, x - k, y, sf::IntRect(0, 0, 1, size.y));
+        page.copy(image, x + size.x - 1 + k, y, sf::IntRect(size.x - 1, 0, 1, size.y));
+        page.copy(image, x, y - k, sf::IntRect(0, 0, size.x, 1));
+        page.copy(image, x, y + size.y - 1 + k, sf::IntRect(0, size.y - 1, size.x, 1));
+      }
+
+      // fill the corners of the padding with the corners of the image
+      for (unsigned i = 1; i <= PADDING; ++i) {
+        for (unsigned j = 1; j <= PADDING; ++j) {
+          page.setPixel(x - i, y - j, image.getPixel(0, 0));
+          page.setPixel(x + size.x - 1 + i, y - j, image.getPixel(size.x - 1, 0));
+          page.setPixel(x - i, y + size.y - 1 + j, image.getPixel(0, size.y - 1));
+          page.setPixel(x + size.x - 1 + i, y + size.y - 1 + j, image.getPixel(size.x - 1, size.y - 1));
+        }
+      }
+
+      entry->image.reset();
+    }
+
+    Log::info(Log::GRAPHICS, "Atlas built: %zu images in %zu textures\n", entries.size(), m_pages.size());
+  }
+
+  void TextureAtlas::upload(bool smooth) {
+    assert(m_textures.empty());
+    ProfileScope scope("TextureAtlas::upload");
+
+    for (auto& page : m_pages) {
+      std::unique_ptr<sf::Texture> texture(new sf::Texture);
+
+      if (!texture->loadFromImage(page)) {
+        Log::error(Log::GRAPHICS, "Could not create a texture for the atlas\n");
+      }
+
+      texture->setSmooth(smooth);
+      m_textures.push_back(std::move(texture));
+    }
+
+    m_pages.clear();
+  }
+
+  sf::Texture *TextureAtlas::getTexture(const boost::filesystem::path& key) const {
+    auto it = m_entries.find(key);
+
+    if (it == m_entries.end() || it->second.page >= m_textures.size()) {
+      return nullptr;
+    }
+
+    return m_textures[it->second.page].get();
+  }
+
+  sf::Vector2i TextureAtlas::getPosition(const boost::filesystem::path& key) const {
+    auto it = m_entries.find(key);
+
+    if (it == m_entries.end() || it->second.page == NO_PAGE) {
+      return { 0, 0 };
+    }
+
+    return { static_cast<int>(it->second.position.x + PADDING), static_cast<int>(it->second.position.y + PADDING) };
+  }
+
+  std::vector<boost::filesystem::path> TextureAtlas::getUnpackedImages() const {
+    std::vector<boost::filesystem::path> keys;
+
+    for (auto& item : m_entries) {
+      if (item.second.page == NO_PAGE) {
+        keys.push_back(item.first);
+      }
+    }
+
+    return keys;
+  }
+
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2014-2015, Julien Bernard
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef GAME_TEXTURE_ATLAS_H
+#define GAME_TEXTURE_ATLAS_H
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include <SFML/Graphics.hpp>
+
+namespace game {
+
+  /**
+   * @ingroup graphics
+   *
+   * A set of images packed in a few large textures.
+   *
+   * The images are added and packed with build(), which can be called on any
+   * thread. Then the textures are created with upload(), on the thread where
+   * a context is active, i.e. the main thread (see RenderThread).
+   */
+  class TextureAtlas {
+  public:
+    static constexpr unsigned PADDING = 2;
+
+    void addImage(const boost::filesystem::path& key, const sf::Image& image);
+
+    bool addImageFromFile(const boost::filesystem::path& key, const boost::filesystem::path& path);
+
+    bool hasImage(const boost::filesystem::path& key) const;
+
+    void build(unsigned maxSize);
+
+    void upload(bool smooth);
+
+    /**
+     * The texture containing the image, or nullptr if the image is not in the atlas.
+     */
+    sf::Texture *getTexture(const boost::filesystem::path& key) const;
+
+    /**
+     * The position of the image in its texture.
+     */
+    sf::Vector2i getPosition(const boost::filesystem::path& key) const;
+
+    /**
+     * The images that could not be packed by build(), e.g. because they are
+     * too big. They must be loaded as separate textures.
+     */
+    std::vector<boost::filesystem::path> getUnpackedImages() const;
+
+    std::size_t getTextureCount() const {
+      return m_textures.size();
+    }
+
+  private:
+    struct Entry {
+      std::unique_ptr<sf::Image> image;
+      std::size_t page;
+      sf::Vector2u position;
+    };
+
+    std::map<boost::filesystem::path, Entry> m_entries;
+    std::vector<sf::Image> m_pages;
+    std::vector<std::unique_ptr<sf::Texture>> m_textures;
+  };
+
+}
+
+#endif // GAME_TEXTURE_ATLAS_H